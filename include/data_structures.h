@@ -5,6 +5,42 @@
 #include <stdint.h>
 
 typedef int (*ds_cmp)(void *, void *);
+typedef uint64_t (*ds_hash)(void *);
+
+/**
+ * @enum ds_mem_flags
+ *
+ * Placement options for the memory backing a dynamic array.
+ */
+enum ds_mem_flags {
+    DS_MEM_HUGEPAGE_ADVISE = 1 << 0, /**< madvise(MADV_HUGEPAGE). */
+    DS_MEM_HUGEPAGE_ALIGN = 1 << 1,  /**< 2 MiB aligned allocation. */
+    DS_MEM_NUMA_BIND = 1 << 2,       /**< only use the nodes in nodemask. */
+    DS_MEM_NUMA_INTERLEAVE = 1 << 3, /**< spread pages over nodemask. */
+    DS_MEM_ALL = (1 << 4) - 1,
+};
+
+/**
+ * @struct ds_mem_policy
+ *
+ * Memory placement policy, see ds_da_set_mem_policy().
+ */
+struct ds_mem_policy {
+    unsigned int flags;     /**< flags is a set of ds_mem_flags. */
+    unsigned long nodemask; /**< nodemask has bit n set to use NUMA node n. */
+};
+
+/**
+ * @struct ds_mem_stats
+ *
+ * Reports how the memory backing a dynamic array was placed.
+ */
+struct ds_mem_stats {
+    unsigned int requested; /**< requested is the policy's ds_mem_flags. */
+    unsigned int applied;   /**< applied is the ds_mem_flags that took effect
+                               for the current allocation. */
+    size_t bytes;           /**< bytes is the size of the allocation. */
+};
 
 /**
  * @struct dynamic_array
@@ -16,6 +52,8 @@ struct dynamic_array {
     size_t lsize; /**< lsize is the total utilised capacity. */
     size_t esize; /**< esize is the size in bytes of an element. */
     char *array;  /**< array is the physical array. */
+    struct ds_mem_policy policy; /**< policy places the physical array. */
+    unsigned int policy_applied; /**< ds_mem_flags that took effect. */
 };
 
 /**
@@ -82,6 +120,35 @@ int ds_da_pop(struct dynamic_array *da, void *element);
  */
 int ds_da_swap(struct dynamic_array *da, size_t idx1, size_t idx2);
 
+/**
+ * Sets the placement policy for the memory backing the dynamic array. The
+ * existing elements are moved to a new allocation under the policy. On
+ * Linux, memory under a policy is a mapping of its own, apart from the
+ * malloc() heap, which grows in place or by remapping without a copy
+ * (except for a huge page aligned mapping that cannot grow in place).
+ * Clearing the policy moves the elements back to a plain allocation. Any
+ * part of the policy that the system cannot honour (e.g. without
+ * transparent huge pages or NUMA support) is skipped, see
+ * ds_da_mem_stats() for what took effect.
+ *
+ * @param[in] da is the dynamic array.
+ * @param[in] policy is the placement policy. NUMA bind and interleave are
+ *            exclusive, and need a non-empty nodemask.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_da_set_mem_policy(struct dynamic_array *da,
+                         const struct ds_mem_policy *policy);
+
+/**
+ * Reports the placement of the memory backing the dynamic array.
+ *
+ * @param[in]  da is the dynamic array.
+ * @param[out] stats will be assigned the requested and applied placement.
+ */
+void ds_da_mem_stats(const struct dynamic_array *da,
+                     struct ds_mem_stats *stats);
+
 /**
  * Free the memory allocated for the dynamic array.
  *
@@ -89,6 +156,411 @@ int ds_da_swap(struct dynamic_array *da, size_t idx1, size_t idx2);
  */
 void ds_da_free(struct dynamic_array *da);
 
+struct cow_table;
+
+/**
+ * @struct cow_array
+ *
+ * Abstract dynamic array that supports constant time read-only snapshots.
+ * Elements are stored in fixed size pages, which snapshots share with the
+ * array. The array copies a shared page only when it is next modified, so
+ * readers of a snapshot never block, or are blocked by, the writer.
+ */
+struct cow_array {
+    size_t esize;            /**< esize is the size in bytes of an element. */
+    size_t page_len;         /**< page_len is the elements per page. */
+    size_t lsize;            /**< lsize is the total utilised capacity. */
+    char *element;           /**< block of size esize for swapping. */
+    struct cow_table *table; /**< table is the reference counted pages. */
+};
+
+/**
+ * @struct cow_snapshot
+ *
+ * Read-only view of a cow_array at the time it was taken.
+ */
+struct cow_snapshot {
+    size_t esize;            /**< esize is the size in bytes of an element. */
+    size_t page_len;         /**< page_len is the elements per page. */
+    size_t lsize;            /**< lsize is the number of elements. */
+    struct cow_table *table; /**< table is the shared pages. */
+};
+
+/**
+ * Allocates a copy-on-write array. The returned array should be freed with
+ * a call to ds_cow_free(). All functions that take the array must be
+ * called from one thread (the writer) or be externally serialised.
+ *
+ * @param[in]  esize is the element size of the array.
+ * @param[out] d_ca is a pointer to the created array.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_cow_create(size_t esize, struct cow_array **d_ca);
+
+/**
+ * Get size of a copy-on-write array.
+ *
+ * @param[in] ca will have its logical size returned.
+ *
+ * @returns the size of the array.
+ */
+static inline size_t ds_cow_len(const struct cow_array *ca) {
+    return ca->lsize;
+}
+
+/**
+ * Retrieves a value from the specified array.
+ *
+ * @param[in]  ca is the array to access.
+ * @param[in]  idx is the position to access the array.
+ * @param[out] element will be assigned the item in the array.
+ *
+ * @returns 0 if successful, otherwise errno-like value.
+ */
+int ds_cow_get_value(const struct cow_array *ca, size_t idx, void *element);
+
+/**
+ * Overwrites a value in the specified array, copying its page first if a
+ * snapshot shares it.
+ *
+ * @param[in] ca is the array to modify.
+ * @param[in] idx is the position to modify.
+ * @param[in] element will be copied into the array.
+ *
+ * @returns 0 if successful, otherwise errno-like value.
+ */
+int ds_cow_set_value(struct cow_array *ca, size_t idx, void *element);
+
+/**
+ * Appends an element to the array.
+ *
+ * @param[in] ca is the array.
+ * @param[in] element will be appended to the array.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_cow_append(struct cow_array *ca, void *element);
+
+/**
+ * Pops an element from the end of the array.
+ *
+ * @param[in]  ca is the array.
+ * @param[out] element will contain the popped type, may be NULL. On failure,
+ *             the element will be unchanged.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_cow_pop(struct cow_array *ca, void *element);
+
+/**
+ * Swaps the two elements in the array, at the specified indices.
+ *
+ * @param[in] ca is the array.
+ * @param[in] idx1 is the first position in the array.
+ * @param[in] idx2 is the second position in the array.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_cow_swap(struct cow_array *ca, size_t idx1, size_t idx2);
+
+/**
+ * Takes a read-only snapshot of the array in constant time. The snapshot
+ * may be read and freed from any thread, independently of the array.
+ *
+ * @param[in]  ca is the array, called from the writer.
+ * @param[out] d_snap is a pointer to the created snapshot, that should be
+ *             freed with a call to ds_cow_snapshot_free().
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_cow_snapshot(const struct cow_array *ca, struct cow_snapshot **d_snap);
+
+/**
+ * Get size of a snapshot.
+ *
+ * @param[in] snap is the snapshot.
+ *
+ * @returns the size of the array when the snapshot was taken.
+ */
+static inline size_t ds_cow_snapshot_len(const struct cow_snapshot *snap) {
+    return snap->lsize;
+}
+
+/**
+ * Retrieves a value from a snapshot.
+ *
+ * @param[in]  snap is the snapshot to access.
+ * @param[in]  idx is the position to access.
+ * @param[out] element will be assigned the item in the snapshot.
+ *
+ * @returns 0 if successful, otherwise errno-like value.
+ */
+int ds_cow_snapshot_get_value(const struct cow_snapshot *snap, size_t idx,
+                              void *element);
+
+/**
+ * Free the passed snapshot. Accepts NULL.
+ *
+ * @param[in] snap will be freed.
+ */
+void ds_cow_snapshot_free(struct cow_snapshot *snap);
+
+/**
+ * Free the array. Pages still used by snapshots are kept until those are
+ * freed. Accepts NULL.
+ *
+ * @param[in] ca is the array to freed.
+ */
+void ds_cow_free(struct cow_array *ca);
+
+/**
+ * @struct mmheap
+ *
+ * Abstract min-max heap, a double-ended priority queue. Levels alternate
+ * between min and max ordering, so both the minimum (the root) and the
+ * maximum (one of its children) are found in constant time.
+ */
+struct mmheap {
+    ds_cmp cmp;    /**< cmp is the method that takes pointers to the stored
+                      elements for comparison. */
+    char *element; /**< block of size esize for swapping elements. */
+    struct dynamic_array array; /**< dynamic array to store heap elements. */
+};
+
+/**
+ * Creates a min-max heap, that should be freed with a call to
+ * ds_mmheap_free().
+ *
+ * @param[in] esize is the element size stored in the heap.
+ * @param[in] cmp_method is a strcmp-like method that operates on two heap
+ *            elements.
+ * @param[out] d_heap is a pointer to the created heap.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_mmheap_create(size_t esize, int (*cmp_method)(void *, void *),
+                     struct mmheap **d_heap);
+
+/**
+ * Get the size of a min-max heap.
+ *
+ * @param[in] heap will have its size.
+ *
+ * @returns the size of the heap
+ */
+static inline size_t ds_mmheap_len(struct mmheap *heap) {
+    return ds_da_len(&heap->array);
+}
+
+/**
+ * Add an element to the heap.
+ *
+ * @param[in] heap is the min-max heap.
+ * @param[in] element will be added to the heap.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_mmheap_add(struct mmheap *heap, void *element);
+
+/**
+ * Retrieve the minimum in the heap.
+ *
+ * @param[in]  heap is the min-max heap.
+ * @param[out] element is a pointer to the type to write the min.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_mmheap_get_min(struct mmheap *heap, void *element);
+
+/**
+ * Retrieve the maximum in the heap.
+ *
+ * @param[in]  heap is the min-max heap.
+ * @param[out] element is a pointer to the type to write the max.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_mmheap_get_max(struct mmheap *heap, void *element);
+
+/**
+ * Pops the minimum from the heap.
+ *
+ * @param[in]  heap contains the min.
+ * @param[out] min will be assigned the popped minimum element, may be NULL.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_mmheap_pop_min(struct mmheap *heap, void *min);
+
+/**
+ * Pops the maximum from the heap.
+ *
+ * @param[in]  heap contains the max.
+ * @param[out] max will be assigned the popped maximum element, may be NULL.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_mmheap_pop_max(struct mmheap *heap, void *max);
+
+/**
+ * Add an element while keeping only the k smallest elements. When the heap
+ * already holds k elements, the larger of the element and the current
+ * maximum is evicted in the same O(log k) operation. For the k largest
+ * elements, invert the comparison. If the heap holds more than k elements,
+ * the largest are first dropped down to k, without being reported through
+ * evicted.
+ *
+ * @param[in]  heap is the min-max heap.
+ * @param[in]  element is offered to the heap.
+ * @param[in]  k is the most elements to keep, at least 1.
+ * @param[out] evicted will be assigned the evicted element, may be NULL.
+ * @param[out] d_evicted will be set to whether an element was evicted.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_mmheap_push_bounded(struct mmheap *heap, void *element, size_t k,
+                           void *evicted, bool *d_evicted);
+
+/**
+ * Free the passed min-max heap. Accepts NULL.
+ *
+ * @param[in] heap will be freed.
+ */
+void ds_mmheap_free(struct mmheap *heap);
+
+/**
+ * @struct packed_array
+ *
+ * Dynamic array of small unsigned integers, packed width bits apiece into
+ * 64-bit words. A width of 1 gives a bit array, which also supports rank
+ * and select.
+ */
+struct packed_array {
+    size_t pwords;      /**< pwords is the number of words allocated. */
+    size_t lsize;       /**< lsize is the number of elements. */
+    unsigned int width; /**< width is the bits per element, 1 to 16. */
+    uint64_t *words;    /**< words is the physical array. */
+};
+
+/**
+ * Allocates a packed array. The returned packed array should be freed with
+ * a call to ds_pa_free().
+ *
+ * @param[in]  width is the bits per element, from 1 to 16.
+ * @param[out] d_pa is a pointer to the created packed array.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_pa_create(unsigned int width, struct packed_array **d_pa);
+
+/**
+ * Get size of a packed array.
+ *
+ * @param[in] pa will have its logical size returned.
+ *
+ * @returns the number of elements in the packed array.
+ */
+static inline size_t ds_pa_len(const struct packed_array *pa) {
+    return pa->lsize;
+}
+
+/**
+ * Retrieves a value from the specified packed array.
+ *
+ * @param[in]  pa is the packed array to access.
+ * @param[in]  idx is the position to access the packed array.
+ * @param[out] value will be assigned the element.
+ *
+ * @returns 0 if successful, otherwise errno-like value.
+ */
+int ds_pa_get_value(const struct packed_array *pa, size_t idx,
+                    uint16_t *value);
+
+/**
+ * Overwrites a value in the specified packed array.
+ *
+ * @param[in] pa is the packed array to modify.
+ * @param[in] idx is the position to modify.
+ * @param[in] value must fit in the packed array's width.
+ *
+ * @returns 0 if successful, otherwise errno-like value.
+ */
+int ds_pa_set_value(struct packed_array *pa, size_t idx, uint16_t value);
+
+/**
+ * Appends an element to the packed array.
+ *
+ * @param[in] pa is the packed array.
+ * @param[in] value must fit in the packed array's width.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_pa_append(struct packed_array *pa, uint16_t value);
+
+/**
+ * Pops an element from the end of the packed array.
+ *
+ * @param[in]  pa is a packed array.
+ * @param[out] value will contain the popped element, may be NULL.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_pa_pop(struct packed_array *pa, uint16_t *value);
+
+/**
+ * Counts the set bits over all elements, for a bit array the number of
+ * true elements.
+ *
+ * @param[in] pa is the packed array.
+ *
+ * @returns the number of set bits.
+ */
+size_t ds_pa_popcount(const struct packed_array *pa);
+
+/**
+ * Finds the first non-zero element at or after start.
+ *
+ * @param[in]  pa is the packed array.
+ * @param[in]  start is the first position to search.
+ * @param[out] idx will be assigned the position of the element.
+ *
+ * @returns 0 on success, ENOENT if there is no such element.
+ */
+int ds_pa_find_first_set(const struct packed_array *pa, size_t start,
+                         size_t *idx);
+
+/**
+ * Counts the set bits before a position in a bit array.
+ *
+ * @param[in]  pa is a packed array of width 1.
+ * @param[in]  idx is the end of the range, up to the length of the array.
+ * @param[out] rank will be assigned the number of set bits in [0, idx).
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_pa_rank(const struct packed_array *pa, size_t idx, size_t *rank);
+
+/**
+ * Finds the position of a set bit in a bit array by its rank, the inverse
+ * of ds_pa_rank().
+ *
+ * @param[in]  pa is a packed array of width 1.
+ * @param[in]  rank is the number of set bits before the one to find.
+ * @param[out] idx will be assigned the position of the set bit.
+ *
+ * @returns 0 on success, ENOENT if there are not enough set bits,
+ *          otherwise errno-like value.
+ */
+int ds_pa_select(const struct packed_array *pa, size_t rank, size_t *idx);
+
+/**
+ * Free the memory allocated for the packed array. Accepts NULL.
+ *
+ * @param[in] pa is the packed array to freed.
+ */
+void ds_pa_free(struct packed_array *pa);
+
 /**
  * @struct heap
  *
@@ -100,6 +572,10 @@ struct heap {
     char *element1,
         *element2; /**< block of size esize for passing the value to . */
     struct dynamic_array array; /**< dynamic array to store heap elements. */
+    size_t heapified;  /**< heapified is the length of the array prefix in
+                          heap order, the rest are buffered inserts. */
+    size_t buffer_max; /**< buffer_max is the most inserts to buffer. */
+    bool rebuild;      /**< rebuild lets a flush rebuild the whole heap. */
 };
 
 /**
@@ -138,6 +614,25 @@ static inline size_t ds_heap_len(struct heap *heap) {
  */
 int ds_heap_add(struct heap *heap, void *element);
 
+/**
+ * Buffer up to buffer_max inserts before ordering them into the heap.
+ * Buffered elements are appended unordered, then sifted up in insertion
+ * order when the buffer fills or the minimum is requested, so the heap
+ * behaves exactly as without the buffer. Defaults to 0, no buffering.
+ *
+ * With rebuild, a batch whose sift ups would cost more than rebuilding
+ * the whole heap, about len / log2(len) elements, is merged by rebuilding
+ * in O(len) instead. That pays off when inserts climb far, e.g. with
+ * descending keys, but not with random keys, which climb about one level.
+ * Elements comparing equal may then come out in a different order.
+ *
+ * @param[in] heap is the min-heap.
+ * @param[in] buffer_max is the most inserts to buffer, 0 to disable.
+ * @param[in] rebuild allows large batches to rebuild the heap.
+ */
+void ds_heap_set_insert_buffer(struct heap *heap, size_t buffer_max,
+                               bool rebuild);
+
 /**
  * Retrieve the minimum in the heap.
  *
@@ -159,6 +654,31 @@ int ds_heap_get_min(struct heap *heap, void *element);
  */
 int ds_heap_pop_min(struct heap *heap, void *min);
 
+/**
+ * Sets the placement policy for the memory backing the heap, see
+ * ds_da_set_mem_policy().
+ *
+ * @param[in] heap is the min-heap.
+ * @param[in] policy is the placement policy.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+static inline int ds_heap_set_mem_policy(struct heap *heap,
+                                         const struct ds_mem_policy *policy) {
+    return ds_da_set_mem_policy(&heap->array, policy);
+}
+
+/**
+ * Reports the placement of the memory backing the heap.
+ *
+ * @param[in]  heap is the min-heap.
+ * @param[out] stats will be assigned the requested and applied placement.
+ */
+static inline void ds_heap_mem_stats(const struct heap *heap,
+                                     struct ds_mem_stats *stats) {
+    ds_da_mem_stats(&heap->array, stats);
+}
+
 /**
  * Free the passed heap. Elements are freed with the free_method passed on
  * creation. Accepts NULL.
@@ -167,4 +687,421 @@ int ds_heap_pop_min(struct heap *heap, void *min);
  */
 void ds_heap_free(struct heap *heap);
 
+/**
+ * @struct external_heap
+ *
+ * Abstract min heap that can outgrow memory. Elements are added to an
+ * in-memory heap of at most budget bytes. Once full, the heap is sorted,
+ * written to a temporary file (a run) and emptied. Runs are read back
+ * sequentially through a buffer, and kept in a min heap ordered by their
+ * next element, so popping compares the in-memory minimum with one run.
+ * At 64 runs the 16 smallest are merged into one, bounding the number of
+ * open files.
+ */
+struct external_heap {
+    ds_cmp cmp;          /**< cmp is the method that takes pointers to the
+                            stored elements for comparison. */
+    size_t esize;        /**< esize is the size in bytes of an element. */
+    size_t max_elements; /**< max_elements is the budget in elements. */
+    size_t len;          /**< len is the total number of elements. */
+    int err;             /**< err is set once a failed merge could not be
+                            undone, every later call then fails with it. */
+    char *dir;           /**< dir is where runs are written. */
+    char *element;       /**< block of size esize for the heap minimum. */
+    struct heap *heap;   /**< heap holds the elements kept in memory. */
+    struct dynamic_array runs; /**< runs are the spilled sorted runs. */
+};
+
+/**
+ * Creates an external heap, that should be freed with a call to
+ * ds_eheap_free().
+ *
+ * @param[in] esize is the element size stored in the heap.
+ * @param[in] cmp_method is a strcmp-like method that operates on two heap
+ *            elements.
+ * @param[in] budget is the most bytes of elements kept in memory, at least
+ *            esize. It is allocated up front, rounded down to whole
+ *            elements plus one spare element used for swaps. Each run
+ *            also holds a 64 KiB read buffer of its own.
+ * @param[in] dir is the directory to write runs to. If NULL, the TMPDIR
+ *            environment variable, or /tmp, is used. Runs are unlinked as
+ *            soon as they are created.
+ * @param[out] d_eheap is a pointer to the created heap.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_eheap_create(size_t esize, int (*cmp_method)(void *, void *),
+                    size_t budget, const char *dir,
+                    struct external_heap **d_eheap);
+
+/**
+ * Get the size of an external heap, including spilled elements.
+ *
+ * @param[in] eheap will have its size.
+ *
+ * @returns the size of the heap
+ */
+static inline size_t ds_eheap_len(const struct external_heap *eheap) {
+    return eheap->len;
+}
+
+/**
+ * Get the number of runs currently spilled to files.
+ *
+ * @param[in] eheap is the external heap.
+ *
+ * @returns the number of runs.
+ */
+static inline size_t ds_eheap_nruns(const struct external_heap *eheap) {
+    return ds_da_len(&eheap->runs);
+}
+
+/**
+ * Add an element to the heap, spilling the in-memory elements to a run
+ * first if the budget is used up.
+ *
+ * @param[in] eheap is the external heap.
+ * @param[in] element will be added to the heap.
+ *
+ * @returns 0 on success, otherwise errno-like value. If writing a run
+ *          fails, such as on a full disk, the element is not added and
+ *          nothing already in the heap is lost. Only if the runs cannot be
+ *          rewound after a failed merge, this and every later call on the
+ *          heap return EIO.
+ */
+int ds_eheap_add(struct external_heap *eheap, void *element);
+
+/**
+ * Retrieve the minimum in the heap.
+ *
+ * @param[in]  eheap is the external heap.
+ * @param[out] element is a pointer to the type to write the min.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_eheap_get_min(struct external_heap *eheap, void *element);
+
+/**
+ * Pops the minimum from the heap.
+ *
+ * @param[in]  eheap contains the min.
+ * @param[out] min will be assigned the popped minimum element.
+ *
+ * @returns 0 on success, otherwise errno-like value. If a run cannot be
+ *          read back, min is still assigned but the rest of the run is lost
+ *          and EIO is returned.
+ */
+int ds_eheap_pop_min(struct external_heap *eheap, void *min);
+
+/**
+ * Free the passed external heap and close its runs. Accepts NULL.
+ *
+ * @param[in] eheap will be freed.
+ */
+void ds_eheap_free(struct external_heap *eheap);
+
+/**
+ * @struct split_heap
+ *
+ * Abstract min heap that stores keys apart from their payloads. The heap
+ * array only holds each key with a 32-bit index to its payload slot, so
+ * sifting moves a few bytes no matter how large the payloads are. Payload
+ * slots freed by pops are reused by later adds.
+ */
+struct split_heap {
+    ds_cmp cmp;     /**< cmp is the method that takes pointers to the stored
+                       keys for comparison. */
+    size_t ksize;   /**< ksize is the size in bytes of a key. */
+    size_t soffset; /**< soffset is the offset of the payload slot index in
+                       a heap entry. */
+    char *entry;    /**< entry is a scratch heap entry used while sifting. */
+    struct dynamic_array entries;    /**< heap ordered keys and slots. */
+    struct dynamic_array payloads;   /**< payload slots. */
+    struct dynamic_array free_slots; /**< indices of unused payload slots. */
+};
+
+/**
+ * Creates a split heap, that should be freed with a call to ds_sheap_free().
+ *
+ * @param[in] ksize is the key size stored in the heap.
+ * @param[in] psize is the payload size stored in the heap.
+ * @param[in] cmp_method is a strcmp-like method that operates on two keys,
+ *            returning less than 0, equal to 0, or greater than zero if k1
+ *            is less than, equal to, or greater than k2.
+ * @param[out] d_heap is a pointer to the created heap.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_sheap_create(size_t ksize, size_t psize,
+                    int (*cmp_method)(void *, void *),
+                    struct split_heap **d_heap);
+
+/**
+ * Get the size of a split heap.
+ *
+ * @param[in] heap will have its size.
+ *
+ * @returns the size of the heap
+ */
+static inline size_t ds_sheap_len(struct split_heap *heap) {
+    return ds_da_len(&heap->entries);
+}
+
+/**
+ * Add a key and its payload to the heap.
+ *
+ * @param[in] heap is the split heap.
+ * @param[in] key will be added to the heap.
+ * @param[in] payload will be stored with the key.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_sheap_add(struct split_heap *heap, void *key, void *payload);
+
+/**
+ * Retrieve the minimum key and its payload.
+ *
+ * @param[in]  heap is the split heap.
+ * @param[out] key will be assigned the minimum key, may be NULL.
+ * @param[out] payload will be assigned the payload of the minimum, may be
+ *             NULL.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_sheap_get_min(struct split_heap *heap, void *key, void *payload);
+
+/**
+ * Pops the minimum key and its payload from the heap.
+ *
+ * @param[in]  heap contains the min.
+ * @param[out] key will be assigned the minimum key, may be NULL.
+ * @param[out] payload will be assigned the payload of the minimum, may be
+ *             NULL.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_sheap_pop_min(struct split_heap *heap, void *key, void *payload);
+
+/**
+ * Free the passed split heap. Accepts NULL.
+ *
+ * @param[in] heap will be freed.
+ */
+void ds_sheap_free(struct split_heap *heap);
+
+/**
+ * @struct merge
+ *
+ * K-way merge of sorted dynamic arrays using a loser tree. Each output
+ * element costs about log2(k) comparisons, made in place on the runs, and
+ * one copy into the output.
+ */
+struct merge {
+    ds_cmp cmp;                  /**< cmp is the method that takes pointers
+                                    to elements for comparison. */
+    size_t k;                    /**< k is the number of runs. */
+    size_t esize;                /**< esize is the size of an element. */
+    size_t remaining;            /**< remaining elements to output. */
+    struct dynamic_array **runs; /**< runs are the sorted inputs. */
+    size_t *pos;                 /**< pos is the next index of each run. */
+    size_t *tree;                /**< tree[0] is the winning run and the
+                                    rest the losers of each match. */
+};
+
+/**
+ * Creates a merge of k sorted runs, that should be freed with a call to
+ * ds_merge_free(). The runs are read in place and must not be modified
+ * while the merge is in use.
+ *
+ * @param[in]  runs is an array of k dynamic arrays, each sorted by
+ *             cmp_method and all with the same element size.
+ * @param[in]  k is the number of runs.
+ * @param[in]  cmp_method is a strcmp-like method that operates on two
+ *             elements.
+ * @param[out] d_merge is a pointer to the created merge.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_merge_create(struct dynamic_array **runs, size_t k,
+                    int (*cmp_method)(void *, void *),
+                    struct merge **d_merge);
+
+/**
+ * Get the number of elements left to output.
+ *
+ * @param[in] merge is the merge.
+ *
+ * @returns the number of elements not yet output.
+ */
+static inline size_t ds_merge_len(const struct merge *merge) {
+    return merge->remaining;
+}
+
+/**
+ * Output up to the next n elements in sorted order. Equal elements are
+ * output in the order of their runs.
+ *
+ * @param[in]  merge is the merge.
+ * @param[out] elements is an array with room for n elements.
+ * @param[in]  n is the maximum number of elements to output.
+ * @param[out] written will be assigned the number of elements output, 0
+ *             once the merge is finished.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_merge_next_n(struct merge *merge, void *elements, size_t n,
+                    size_t *written);
+
+/**
+ * Free the passed merge, the runs are not freed. Accepts NULL.
+ *
+ * @param[in] merge will be freed.
+ */
+void ds_merge_free(struct merge *merge);
+
+/**
+ * @struct hash_map
+ *
+ * Open-addressing hash map with type-erased keys and values. Slots are
+ * grouped in sixteens, each slot having a control byte recording whether it
+ * is empty, deleted, or full with the low 7 bits of the key's hash. Probing
+ * compares a whole group of control bytes at once (with SSE2 if available),
+ * and each key and value pair lives in a flat slot array so entries are
+ * never individually allocated.
+ */
+struct hash_map {
+    size_t ksize;       /**< ksize is the size in bytes of a key. */
+    size_t vsize;       /**< vsize is the size in bytes of a value. */
+    ds_hash hash;       /**< hash is the method that hashes a key. */
+    ds_cmp eq;          /**< eq returns 0 when two keys are equal. */
+    float max_load;     /**< max_load is the highest fraction of slots that
+                           may be used before the table grows. */
+    size_t len;         /**< len is the number of entries stored. */
+    size_t capacity;    /**< capacity is the number of slots. */
+    size_t growth_left; /**< growth_left is the number of empty slots that
+                           can be filled before a rehash. */
+    size_t voffset;     /**< voffset is the offset of a value from its
+                           key, aligned for the value. */
+    size_t stride;      /**< stride is the size of a key and value slot,
+                           aligned so every key is aligned. */
+    int8_t *ctrl;       /**< ctrl is the control byte of each slot. */
+    char *slots;        /**< slots is the physical array of keys, each
+                           followed by its value. */
+};
+
+/**
+ * Creates a hash map, that should be freed with a call to ds_hm_free().
+ *
+ * Keys passed to hash and eq are aligned to the largest power of two that
+ * divides ksize, up to alignof(max_align_t).
+ *
+ * @param[in]  ksize is the key size stored in the hash map.
+ * @param[in]  vsize is the value size stored in the hash map, may be zero.
+ * @param[in]  hash is a method that hashes a key. All 64 bits are used, so
+ *             it should mix well.
+ * @param[in]  eq is a method returning 0 when two keys are equal.
+ * @param[out] d_hm is a pointer to the created hash map.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_hm_create(size_t ksize, size_t vsize, ds_hash hash, ds_cmp eq,
+                 struct hash_map **d_hm);
+
+/**
+ * Get the number of entries in a hash map.
+ *
+ * @param[in] hm is the hash map.
+ *
+ * @returns the number of entries.
+ */
+static inline size_t ds_hm_len(const struct hash_map *hm) { return hm->len; }
+
+/**
+ * Sets the maximum load factor, the table is resized if it is now over the
+ * limit. Defaults to 0.875, lower values trade memory for shorter probes.
+ *
+ * @param[in] hm is the hash map.
+ * @param[in] max_load is in the range (0, 1).
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_hm_set_max_load(struct hash_map *hm, float max_load);
+
+/**
+ * Grow the hash map so that n entries can be stored without a rehash.
+ *
+ * @param[in] hm is the hash map.
+ * @param[in] n is the number of entries to make room for.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_hm_reserve(struct hash_map *hm, size_t n);
+
+/**
+ * Inserts a key and value, replacing the value if the key is present.
+ *
+ * @param[in] hm is the hash map.
+ * @param[in] key will be copied into the hash map.
+ * @param[in] value will be copied into the hash map.
+ *
+ * @returns 0 on success, otherwise errno-like value.
+ */
+int ds_hm_insert(struct hash_map *hm, void *key, void *value);
+
+/**
+ * Inserts n keys and values, reserving space for all of them up-front.
+ *
+ * @param[in] hm is the hash map.
+ * @param[in] keys is an array of n keys.
+ * @param[in] values is an array of n values.
+ * @param[in] n is the number of entries to insert.
+ *
+ * @returns 0 on success, otherwise errno-like value. On failure some of the
+ *          entries may have been inserted.
+ */
+int ds_hm_insert_bulk(struct hash_map *hm, void *keys, void *values,
+                      size_t n);
+
+/**
+ * Looks up the value for a key.
+ *
+ * @param[in]  hm is the hash map.
+ * @param[in]  key is the key to look up.
+ * @param[out] value will be assigned the value of the key, may be NULL.
+ *
+ * @returns 0 on success, ENOENT if the key is not present.
+ */
+int ds_hm_get(const struct hash_map *hm, void *key, void *value);
+
+/**
+ * Removes a key from the hash map.
+ *
+ * @param[in] hm is the hash map.
+ * @param[in] key is the key to remove.
+ *
+ * @returns 0 on success, ENOENT if the key is not present.
+ */
+int ds_hm_erase(struct hash_map *hm, void *key);
+
+/**
+ * Iterates the entries of a hash map, in no particular order. The hash map
+ * must not be modified during iteration.
+ *
+ * @param[in]     hm is the hash map.
+ * @param[in,out] iter is the iteration position, should start at 0.
+ * @param[out]    key will be assigned the next key, may be NULL.
+ * @param[out]    value will be assigned the next value, may be NULL.
+ *
+ * @returns 0 on success, ENOENT when there are no more entries.
+ */
+int ds_hm_next(const struct hash_map *hm, size_t *iter, void *key,
+               void *value);
+
+/**
+ * Free the passed hash map. Accepts NULL.
+ *
+ * @param[in] hm will be freed.
+ */
+void ds_hm_free(struct hash_map *hm);
+
 #endif /* __DATA_STRUCTURES_H__ */
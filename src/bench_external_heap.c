@@ -0,0 +1,74 @@
+#include <data_structures.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static int u64cmp(void *v1, void *v2) {
+    uint64_t *i1 = v1;
+    uint64_t *i2 = v2;
+    return (*i1 > *i2) - (*i1 < *i2);
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * usage: external_heap.bench [elements] [budget_bytes] [dir]
+ *
+ * Adds random 8-byte elements then pops them all, through a queue whose
+ * in-memory budget is a fraction of its size. Defaults to 8M elements
+ * (64 MiB) under a 4 MiB budget.
+ */
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 1 << 23;
+    size_t budget = argc > 2 ? strtoull(argv[2], NULL, 10) : 1 << 22;
+    const char *dir = argc > 3 ? argv[3] : NULL;
+    struct external_heap *eheap;
+    uint64_t element, prev;
+    size_t nruns;
+    double start, elapsed;
+    int err;
+
+    err = ds_eheap_create(sizeof(uint64_t), u64cmp, budget, dir, &eheap);
+    if (err != 0) {
+        fprintf(stderr, "external heap setup failed: %d\n", err);
+        return 1;
+    }
+    printf("elements %zu (%zu bytes), budget %zu bytes\n", n,
+           n * sizeof(uint64_t), budget);
+
+    srand(1);
+    start = now();
+    for (size_t i = 0; i < n; i++) {
+        element = ((uint64_t)rand() << 31) ^ rand();
+        err = ds_eheap_add(eheap, &element);
+        if (err != 0) {
+            fprintf(stderr, "add failed: %d\n", err);
+            return 1;
+        }
+    }
+    elapsed = now() - start;
+    nruns = ds_eheap_nruns(eheap);
+    printf("add     %8.3f s %8.1f ns/op, %zu runs\n", elapsed,
+           elapsed * 1e9 / n, nruns);
+
+    prev = 0;
+    start = now();
+    for (size_t i = 0; i < n; i++) {
+        err = ds_eheap_pop_min(eheap, &element);
+        if (err != 0 || element < prev) {
+            fprintf(stderr, "pop failed: %d\n", err);
+            return 1;
+        }
+        prev = element;
+    }
+    elapsed = now() - start;
+    printf("pop_min %8.3f s %8.1f ns/op\n", elapsed, elapsed * 1e9 / n);
+
+    ds_eheap_free(eheap);
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include <data_structures.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static uint64_t u64hash(void *v) {
+    uint64_t h = *(uint64_t *)v;
+
+    /* splitmix64 finaliser */
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+static int u64eq(void *v1, void *v2) {
+    return *(uint64_t *)v1 != *(uint64_t *)v2;
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *op, size_t n, double start) {
+    double elapsed = now() - start;
+
+    printf("%-12s %10zu ops %8.3f s %8.1f ns/op\n", op, n, elapsed,
+           elapsed * 1e9 / n);
+}
+
+/* Fisher-Yates with xorshift64, rand() is too short for 100M keys */
+static void shuffle(uint64_t *keys, size_t n, uint64_t seed) {
+    for (size_t i = n; i > 1; i--) {
+        uint64_t key;
+        size_t j;
+
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        j = seed % i;
+
+        key = keys[i - 1];
+        keys[i - 1] = keys[j];
+        keys[j] = key;
+    }
+}
+
+/*
+ * Time n entries through one map. The splitmix64 finaliser is a bijection,
+ * so hashing 0..n-1 gives n distinct keys and n..2n-1 gives n misses.
+ * Lookups and erases go in a shuffled order, not the insertion order.
+ */
+static int run(size_t n, float max_load, uint64_t *keys, uint64_t *checksum) {
+    struct hash_map *hm;
+    uint64_t value;
+    double start;
+    int err;
+
+    err = ds_hm_create(sizeof(uint64_t), sizeof(uint64_t), u64hash, u64eq,
+                       &hm);
+    if (err != 0) {
+        return err;
+    }
+    err = ds_hm_set_max_load(hm, max_load);
+    if (err != 0) {
+        ds_hm_free(hm);
+        return err;
+    }
+
+    for (uint64_t i = 0; i < n; i++) {
+        keys[i] = u64hash(&i);
+    }
+
+    start = now();
+    for (size_t i = 0; i < n && err == 0; i++) {
+        err = ds_hm_insert(hm, &keys[i], &i);
+    }
+    if (err != 0) {
+        ds_hm_free(hm);
+        return err;
+    }
+    report("insert", n, start);
+
+    shuffle(keys, n, n);
+    start = now();
+    for (size_t i = 0; i < n; i++) {
+        ds_hm_get(hm, &keys[i], &value);
+        *checksum += value;
+    }
+    report("lookup hit", n, start);
+
+    start = now();
+    for (uint64_t i = n; i < 2 * n; i++) {
+        uint64_t key = u64hash(&i);
+
+        *checksum += ds_hm_get(hm, &key, &value);
+    }
+    report("lookup miss", n, start);
+
+    start = now();
+    for (size_t i = 0; i < n; i++) {
+        ds_hm_erase(hm, &keys[i]);
+    }
+    report("erase", n, start);
+    ds_hm_free(hm);
+
+    /* Reserving up-front avoids every intermediate rehash */
+    err = ds_hm_create(sizeof(uint64_t), sizeof(uint64_t), u64hash, u64eq,
+                       &hm);
+    if (err != 0) {
+        return err;
+    }
+    ds_hm_set_max_load(hm, max_load);
+    start = now();
+    err = ds_hm_reserve(hm, n);
+    for (size_t i = 0; i < n && err == 0; i++) {
+        err = ds_hm_insert(hm, &keys[i], &i);
+    }
+    if (err == 0) {
+        report("reserved", n, start);
+    }
+    ds_hm_free(hm);
+    return err;
+}
+
+/*
+ * usage: hash_map.bench [max_entries] [max_load]
+ *
+ * Inserts, looks up (hits and misses) and erases entries with 8-byte keys
+ * and values, sweeping the table from 1M entries up to max_entries (100M
+ * by default) in steps of about sqrt(10), at the default load factor
+ * unless given. Stops early if the table no longer fits in memory.
+ */
+int main(int argc, char **argv) {
+    size_t max_n = argc > 1 ? strtoull(argv[1], NULL, 10) : 100000000;
+    float max_load = argc > 2 ? strtof(argv[2], NULL) : 0.875f;
+    size_t sizes[] = {1000000, 3000000, 10000000, 30000000, 100000000};
+    uint64_t checksum = 0;
+    uint64_t *keys;
+
+    keys = malloc(max_n * sizeof(*keys));
+    if (!keys) {
+        fprintf(stderr, "out of memory for %zu keys\n", max_n);
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); i++) {
+        size_t n = sizes[i] < max_n ? sizes[i] : max_n;
+        int err;
+
+        printf("entries %zu, max load %.3f\n", n, max_load);
+        err = run(n, max_load, keys, &checksum);
+        if (err != 0) {
+            fprintf(stderr, "stopping at %zu entries: %d\n", n, err);
+            break;
+        }
+        if (n == max_n) {
+            break;
+        }
+    }
+    free(keys);
+
+    printf("checksum %llu\n", (unsigned long long)checksum);
+    return 0;
+}
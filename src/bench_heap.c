@@ -0,0 +1,121 @@
+#include <data_structures.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define ARRAY_LEN(A) (sizeof(A) / sizeof(*A))
+
+static int u64cmp(void *v1, void *v2) {
+    uint64_t *i1 = v1;
+    uint64_t *i2 = v2;
+    return (*i1 > *i2) - (*i1 < *i2);
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_key;
+
+/* Random keys, or keys below everything added before */
+static uint64_t next_element(bool descending) {
+    return descending ? next_key-- : ((uint64_t)rand() << 31) ^ rand();
+}
+
+/*
+ * Fill the heap with size elements, then add batches of elements, popping
+ * one element for every ratio added, until total elements were added.
+ * Returns the time spent adding and popping. The checksum depends on the
+ * order elements were popped in.
+ */
+static double run(size_t size, size_t ratio, size_t batch, size_t total,
+                  size_t buffer_max, bool rebuild, bool descending,
+                  uint64_t *checksum) {
+    struct heap *heap;
+    uint64_t element;
+    double start;
+
+    ds_heap_create(sizeof(element), u64cmp, &heap);
+
+    srand(batch);
+    next_key = UINT64_MAX;
+    for (size_t i = 0; i < size; i++) {
+        element = next_element(descending);
+        ds_heap_add(heap, &element);
+    }
+    ds_heap_set_insert_buffer(heap, buffer_max, rebuild);
+
+    start = now();
+    for (size_t added = 0; added < total; added += batch) {
+        for (size_t i = 0; i < batch; i++) {
+            element = next_element(descending);
+            ds_heap_add(heap, &element);
+        }
+        for (size_t i = 0; i < (batch + ratio - 1) / ratio; i++) {
+            ds_heap_pop_min(heap, &element);
+            *checksum = *checksum * 31 + element;
+        }
+    }
+    start = now() - start;
+
+    ds_heap_free(heap);
+    return start;
+}
+
+/*
+ * usage: heap.bench [size]
+ *
+ * Starts from a heap of size elements (default 100k), then adds 16 * size
+ * elements in batches, popping one element per ratio adds after each
+ * batch. Sweeps the add:pop ratio and the batch size, for random and for
+ * descending keys. Compares plain adds, a buffer holding a whole batch
+ * that is sifted up in order, and the same buffer allowed to rebuild the
+ * heap.
+ *
+ * With random keys a sift up climbs about one level, so buffering saves
+ * nothing. With descending keys every sift up climbs to the root, which
+ * is where rebuilding pays off.
+ */
+int main(int argc, char **argv) {
+    size_t size = argc > 1 ? strtoull(argv[1], NULL, 10) : 100000;
+    size_t total = 16 * size;
+    size_t ratios[] = {1, 4, 20};
+    size_t divisors[] = {256, 16, 4, 1};
+
+    printf("heap size %zu, %zu adds per run\n", size, total);
+    for (int descending = 0; descending <= 1; descending++) {
+        printf("%s keys\n", descending ? "descending" : "random");
+        printf("%6s %10s %14s %14s %14s\n", "ratio", "batch", "plain ns/add",
+               "buffer ns/add", "rebuild ns/add");
+
+        for (size_t i = 0; i < ARRAY_LEN(ratios); i++) {
+            for (size_t j = 0; j < ARRAY_LEN(divisors); j++) {
+                uint64_t plain_sum = 0, buffered_sum = 0, rebuild_sum = 0;
+                double plain, buffered, rebuild;
+                size_t batch = size / divisors[j];
+
+                if (batch == 0) {
+                    continue;
+                }
+
+                plain = run(size, ratios[i], batch, total, 0, false,
+                            descending, &plain_sum);
+                buffered = run(size, ratios[i], batch, total, batch, false,
+                               descending, &buffered_sum);
+                rebuild = run(size, ratios[i], batch, total, batch, true,
+                              descending, &rebuild_sum);
+                /* Rebuilding may reorder equal keys, there are none here */
+                printf("%6zu %10zu %14.1f %14.1f %14.1f%s\n", ratios[i], batch,
+                       plain * 1e9 / total, buffered * 1e9 / total,
+                       rebuild * 1e9 / total,
+                       plain_sum == buffered_sum && plain_sum == rebuild_sum
+                           ? ""
+                           : " MISMATCH");
+            }
+        }
+    }
+    return 0;
+}
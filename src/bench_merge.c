@@ -0,0 +1,136 @@
+#include <data_structures.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BATCH 1024
+
+struct head {
+    uint64_t value;
+    size_t run;
+};
+
+static int u64cmp(void *v1, void *v2) {
+    uint64_t *i1 = v1;
+    uint64_t *i2 = v2;
+    return (*i1 > *i2) - (*i1 < *i2);
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool is_sorted(const uint64_t *out, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        if (out[i] < out[i - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Both merges write every element to out, BATCH at a time for the tree */
+static double bench_loser_tree(struct dynamic_array **runs, size_t k,
+                               uint64_t *out) {
+    struct merge *merge;
+    size_t written;
+    double start;
+
+    start = now();
+    ds_merge_create(runs, k, u64cmp, &merge);
+    do {
+        ds_merge_next_n(merge, out, BATCH, &written);
+        out += written;
+    } while (written > 0);
+    ds_merge_free(merge);
+    return now() - start;
+}
+
+/* One pop_min and one add per output element */
+static double bench_heap(struct dynamic_array **runs, size_t k,
+                         uint64_t *out) {
+    struct heap *heap;
+    struct head head;
+    size_t *pos;
+    double start;
+
+    pos = calloc(k, sizeof(*pos));
+    start = now();
+    ds_heap_create(sizeof(head), u64cmp, &heap);
+    for (size_t r = 0; r < k; r++) {
+        head.run = r;
+        if (ds_da_get_value(runs[r], pos[r]++, &head.value) == 0) {
+            ds_heap_add(heap, &head);
+        }
+    }
+
+    while (ds_heap_pop_min(heap, &head) == 0) {
+        *out++ = head.value;
+        if (ds_da_get_value(runs[head.run], pos[head.run]++, &head.value) ==
+            0) {
+            ds_heap_add(heap, &head);
+        }
+    }
+    ds_heap_free(heap);
+    free(pos);
+    return now() - start;
+}
+
+/*
+ * usage: merge.bench [elements]
+ *
+ * Merges the same total number of 8-byte elements split into k sorted runs,
+ * for k = 4..1024, with the loser tree and with struct heap. Defaults to 4M
+ * elements. Both outputs are checked to be sorted and identical.
+ */
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 1 << 22;
+    uint64_t *tree_out = malloc(n * sizeof(*tree_out));
+    uint64_t *heap_out = malloc(n * sizeof(*heap_out));
+
+    if (!tree_out || !heap_out) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    printf("elements %zu\n", n);
+    printf("%6s %14s %14s\n", "k", "loser ns/elem", "heap ns/elem");
+    for (size_t k = 4; k <= 1024; k *= 2) {
+        struct dynamic_array **runs;
+        double tree_time, heap_time;
+
+        runs = malloc(k * sizeof(*runs));
+        srand(k);
+        for (size_t r = 0; r < k; r++) {
+            uint64_t value = 0;
+
+            ds_da_create(sizeof(uint64_t), &runs[r]);
+            for (size_t i = r; i < n; i += k) {
+                value += rand() % 16;
+                ds_da_append(runs[r], &value);
+            }
+        }
+
+        tree_time = bench_loser_tree(runs, k, tree_out);
+        heap_time = bench_heap(runs, k, heap_out);
+        printf("%6zu %14.1f %14.1f%s%s\n", k, tree_time * 1e9 / n,
+               heap_time * 1e9 / n,
+               is_sorted(tree_out, n) && is_sorted(heap_out, n)
+                   ? ""
+                   : " UNSORTED",
+               memcmp(tree_out, heap_out, n * sizeof(*tree_out)) == 0
+                   ? ""
+                   : " MISMATCH");
+
+        for (size_t r = 0; r < k; r++) {
+            ds_da_free(runs[r]);
+        }
+        free(runs);
+    }
+    free(tree_out);
+    free(heap_out);
+    return 0;
+}
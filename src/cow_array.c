@@ -0,0 +1,319 @@
+#include <data_structures.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#define PAGE_BYTES 4096
+#define INITAL_PAGES 4
+#define GROWTH_FACTOR 1.5f
+
+/**
+ * A fixed size chunk of elements, shared by every table that points to it.
+ */
+struct cow_page {
+    atomic_size_t refs; /**< refs is the number of tables using the page. */
+    char data[];        /**< data holds page_len elements. */
+};
+
+/**
+ * The pages of an array, shared by the array and its snapshots until the
+ * array is next modified.
+ */
+struct cow_table {
+    atomic_size_t refs;       /**< refs is the array plus its snapshots. */
+    size_t npages;            /**< npages is the number of pages used. */
+    size_t cap;               /**< cap is the room for page pointers. */
+    struct cow_page *pages[]; /**< pages are the chunks of elements. */
+};
+
+static inline size_t page_bytes(const struct cow_array *ca) {
+    return ca->page_len * ca->esize;
+}
+
+/* Only the writer adds references, so a count of 1 cannot be raced */
+static inline bool is_exclusive(atomic_size_t *refs) {
+    return atomic_load_explicit(refs, memory_order_acquire) == 1;
+}
+
+static void release_page(struct cow_page *page) {
+    if (atomic_fetch_sub_explicit(&page->refs, 1, memory_order_acq_rel) == 1) {
+        free(page);
+    }
+}
+
+static void release_table(struct cow_table *table) {
+    if (atomic_fetch_sub_explicit(&table->refs, 1, memory_order_acq_rel) !=
+        1) {
+        return;
+    }
+
+    for (size_t i = 0; i < table->npages; i++) {
+        release_page(table->pages[i]);
+    }
+    free(table);
+}
+
+static struct cow_table *alloc_table(size_t cap) {
+    struct cow_table *table;
+
+    table = malloc(sizeof(*table) + cap * sizeof(*table->pages));
+    if (!table) {
+        return NULL;
+    }
+
+    atomic_init(&table->refs, 1);
+    table->npages = 0;
+    table->cap = cap;
+    return table;
+}
+
+/*
+ * Make the array's table private with room for at least cap pages. A
+ * shared table is copied, which shares its pages one reference more.
+ */
+static int ds_cow_own_table(struct cow_array *ca, size_t cap) {
+    struct cow_table *old = ca->table, *table;
+
+    if (cap < old->cap) {
+        cap = old->cap;
+    }
+
+    if (is_exclusive(&old->refs)) {
+        if (cap == old->cap) {
+            return 0;
+        }
+
+        table = realloc(old, sizeof(*table) + cap * sizeof(*table->pages));
+        if (!table) {
+            return errno;
+        }
+        table->cap = cap;
+        ca->table = table;
+        return 0;
+    }
+
+    table = alloc_table(cap);
+    if (!table) {
+        return errno;
+    }
+
+    for (size_t i = 0; i < old->npages; i++) {
+        atomic_fetch_add_explicit(&old->pages[i]->refs, 1,
+                                  memory_order_relaxed);
+        table->pages[i] = old->pages[i];
+    }
+    table->npages = old->npages;
+    ca->table = table;
+    release_table(old);
+    return 0;
+}
+
+/* Get a pointer to write element idx, copying its page if it is shared */
+static int ds_cow_writable(struct cow_array *ca, size_t idx, char **d_ptr) {
+    size_t pindex = idx / ca->page_len;
+    struct cow_page *page, *copy;
+    int err;
+
+    err = ds_cow_own_table(ca, 0);
+    if (err != 0) {
+        return err;
+    }
+
+    page = ca->table->pages[pindex];
+    if (!is_exclusive(&page->refs)) {
+        copy = malloc(sizeof(*copy) + page_bytes(ca));
+        if (!copy) {
+            return errno;
+        }
+
+        atomic_init(&copy->refs, 1);
+        memcpy(copy->data, page->data, page_bytes(ca));
+        ca->table->pages[pindex] = copy;
+        release_page(page);
+        page = copy;
+    }
+
+    *d_ptr = page->data + idx % ca->page_len * ca->esize;
+    return 0;
+}
+
+static inline char *get_ptr(const struct cow_table *table, size_t page_len,
+                            size_t esize, size_t idx) {
+    return table->pages[idx / page_len]->data + idx % page_len * esize;
+}
+
+int ds_cow_create(size_t esize, struct cow_array **d_ca) {
+    struct cow_array *ca;
+    int err;
+
+    if (esize == 0) {
+        return EINVAL;
+    }
+
+    ca = malloc(sizeof(*ca));
+    if (!ca) {
+        return errno;
+    }
+
+    ca->element = malloc(esize);
+    ca->table = alloc_table(INITAL_PAGES);
+    if (!ca->element || !ca->table) {
+        err = errno;
+        free(ca->element);
+        free(ca->table);
+        free(ca);
+        return err;
+    }
+
+    ca->esize = esize;
+    ca->page_len = esize < PAGE_BYTES ? PAGE_BYTES / esize : 1;
+    ca->lsize = 0;
+    *d_ca = ca;
+    return 0;
+}
+
+int ds_cow_get_value(const struct cow_array *ca, size_t idx, void *element) {
+    if (idx >= ca->lsize) {
+        return EINVAL;
+    }
+
+    memcpy(element, get_ptr(ca->table, ca->page_len, ca->esize, idx),
+           ca->esize);
+    return 0;
+}
+
+int ds_cow_set_value(struct cow_array *ca, size_t idx, void *element) {
+    char *ptr;
+    int err;
+
+    if (idx >= ca->lsize) {
+        return EINVAL;
+    }
+
+    err = ds_cow_writable(ca, idx, &ptr);
+    if (err != 0) {
+        return err;
+    }
+
+    memcpy(ptr, element, ca->esize);
+    return 0;
+}
+
+int ds_cow_append(struct cow_array *ca, void *element) {
+    size_t pindex = ca->lsize / ca->page_len;
+    char *ptr;
+    int err;
+
+    if (pindex >= ca->table->npages) {
+        struct cow_page *page;
+        size_t cap = ca->table->cap;
+
+        if (pindex >= cap) {
+            cap = cap * GROWTH_FACTOR + 1;
+        }
+        err = ds_cow_own_table(ca, cap);
+        if (err != 0) {
+            return err;
+        }
+
+        page = malloc(sizeof(*page) + page_bytes(ca));
+        if (!page) {
+            return errno;
+        }
+        atomic_init(&page->refs, 1);
+        ca->table->pages[ca->table->npages++] = page;
+    }
+
+    err = ds_cow_writable(ca, ca->lsize, &ptr);
+    if (err != 0) {
+        return err;
+    }
+
+    memcpy(ptr, element, ca->esize);
+    ca->lsize++;
+    return 0;
+}
+
+int ds_cow_pop(struct cow_array *ca, void *element) {
+    if (ca->lsize == 0) {
+        return EINVAL;
+    }
+
+    /* Snapshots keep their own length, so the slot need not be cleared */
+    if (element) {
+        ds_cow_get_value(ca, ca->lsize - 1, element);
+    }
+    ca->lsize--;
+    return 0;
+}
+
+int ds_cow_swap(struct cow_array *ca, size_t idx1, size_t idx2) {
+    char *ptr1, *ptr2;
+    int err;
+
+    if (idx1 >= ca->lsize || idx2 >= ca->lsize) {
+        return EINVAL;
+    }
+
+    err = ds_cow_writable(ca, idx1, &ptr1);
+    if (err != 0) {
+        return err;
+    }
+    err = ds_cow_writable(ca, idx2, &ptr2);
+    if (err != 0) {
+        return err;
+    }
+
+    memcpy(ca->element, ptr1, ca->esize);
+    memcpy(ptr1, ptr2, ca->esize);
+    memcpy(ptr2, ca->element, ca->esize);
+    return 0;
+}
+
+int ds_cow_snapshot(const struct cow_array *ca,
+                    struct cow_snapshot **d_snap) {
+    struct cow_snapshot *snap;
+
+    snap = malloc(sizeof(*snap));
+    if (!snap) {
+        return errno;
+    }
+
+    atomic_fetch_add_explicit(&ca->table->refs, 1, memory_order_relaxed);
+    snap->table = ca->table;
+    snap->esize = ca->esize;
+    snap->page_len = ca->page_len;
+    snap->lsize = ca->lsize;
+    *d_snap = snap;
+    return 0;
+}
+
+int ds_cow_snapshot_get_value(const struct cow_snapshot *snap, size_t idx,
+                              void *element) {
+    if (idx >= snap->lsize) {
+        return EINVAL;
+    }
+
+    memcpy(element, get_ptr(snap->table, snap->page_len, snap->esize, idx),
+           snap->esize);
+    return 0;
+}
+
+void ds_cow_snapshot_free(struct cow_snapshot *snap) {
+    if (!snap) {
+        return;
+    }
+    release_table(snap->table);
+    free(snap);
+}
+
+void ds_cow_free(struct cow_array *ca) {
+    if (!ca) {
+        return;
+    }
+    release_table(ca->table);
+    free(ca->element);
+    free(ca);
+}
@@ -5,6 +5,8 @@
 #include <string.h>
 #include <sys/types.h>
 
+#include "internal.h"
+
 #define INITAL_SIZE (1 << 5)
 #define GROWTH_FACTOR 1.5f
 
@@ -42,7 +44,8 @@ static int ds_da_grow(struct dynamic_array *da) {
         physical_size = SIZE_MAX;
     }
 
-    new_array = realloc(da->array, physical_size * da->esize);
+    new_array =
+        ds_mem_realloc(da, da->psize * da->esize, physical_size * da->esize);
     if (!new_array) {
         return errno;
     }
@@ -65,6 +68,9 @@ int ds_da_init(size_t esize, struct dynamic_array *da) {
     da->psize = INITAL_SIZE;
     da->esize = esize;
     da->lsize = 0;
+    da->policy.flags = 0;
+    da->policy.nodemask = 0;
+    da->policy_applied = 0;
     return 0;
 }
 
@@ -152,10 +158,40 @@ int ds_da_pop(struct dynamic_array *da, void *element) {
     return 0;
 }
 
+int ds_da_reserve(struct dynamic_array *da, size_t psize) {
+    char *new_array;
+
+    if (psize <= da->psize) {
+        return 0;
+    }
+    if (psize > SIZE_MAX / da->esize) {
+        return ENOMEM;
+    }
+
+    new_array = ds_mem_realloc(da, da->psize * da->esize, psize * da->esize);
+    if (!new_array) {
+        return errno;
+    }
+
+    da->array = new_array;
+    clear_values(da, da->psize, psize - da->psize);
+    da->psize = psize;
+    return 0;
+}
+
+void ds_da_truncate(struct dynamic_array *da, size_t len) {
+    if (len >= da->lsize) {
+        return;
+    }
+
+    clear_values(da, len, da->lsize - len);
+    da->lsize = len;
+}
+
 void ds_da_free(struct dynamic_array *da) {
     if (!da) {
         return;
     }
-    free(da->array);
+    ds_mem_free(da);
     free(da);
 }
@@ -0,0 +1,480 @@
+#include <data_structures.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+#define SPILL_TEMPLATE "/ds_spill_XXXXXX"
+#define SPILL_BUFSIZE (1 << 16)
+#define MAX_RUNS 64
+#define MERGE_RUNS 16
+
+/**
+ * A sorted run spilled to an unlinked file, read back sequentially.
+ */
+struct spill_run {
+    FILE *file;            /**< file holds the elements after head. */
+    size_t remaining;      /**< remaining elements in the file. */
+    off_t mark;            /**< mark is the file offset saved by a merge. */
+    size_t mark_remaining; /**< mark_remaining is remaining at the mark. */
+    char head[];           /**< head is the smallest element left in the
+                              run, followed by the head at the mark. */
+};
+
+/* Largest runs first, leaving the smallest at the end */
+static int sort_runs(const void *v1, const void *v2) {
+    const struct spill_run *r1 = *(struct spill_run *const *)v1;
+    const struct spill_run *r2 = *(struct spill_run *const *)v2;
+
+    return (r1->remaining < r2->remaining) - (r1->remaining > r2->remaining);
+}
+
+static inline struct spill_run **get_runs(const struct external_heap *eheap) {
+    return (struct spill_run **)eheap->runs.array;
+}
+
+static inline bool run_less(const struct external_heap *eheap,
+                            const struct spill_run *r1,
+                            const struct spill_run *r2) {
+    return eheap->cmp((void *)r1->head, (void *)r2->head) < 0;
+}
+
+/*
+ * Runs are kept in a min heap ordered by their heads, so the run holding
+ * the smallest spilled element is always runs[0].
+ */
+static void runs_sift_down(const struct external_heap *eheap,
+                           struct spill_run **runs, size_t len, size_t idx) {
+    struct spill_run *run = runs[idx];
+
+    for (;;) {
+        size_t cindex = 2 * idx + 1;
+
+        if (cindex >= len) {
+            break;
+        }
+        if (cindex + 1 < len &&
+            run_less(eheap, runs[cindex + 1], runs[cindex])) {
+            cindex++;
+        }
+        if (!run_less(eheap, runs[cindex], run)) {
+            break;
+        }
+        runs[idx] = runs[cindex];
+        idx = cindex;
+    }
+    runs[idx] = run;
+}
+
+static void runs_sift_up(const struct external_heap *eheap,
+                         struct spill_run **runs, size_t idx) {
+    struct spill_run *run = runs[idx];
+
+    while (idx > 0) {
+        size_t pindex = (idx - 1) / 2;
+
+        if (!run_less(eheap, run, runs[pindex])) {
+            break;
+        }
+        runs[idx] = runs[pindex];
+        idx = pindex;
+    }
+    runs[idx] = run;
+}
+
+static void runs_heapify(const struct external_heap *eheap,
+                         struct spill_run **runs, size_t len) {
+    for (size_t idx = len / 2; idx > 0; idx--) {
+        runs_sift_down(eheap, runs, len, idx - 1);
+    }
+}
+
+static void free_run(struct spill_run *run) {
+    fclose(run->file);
+    free(run);
+}
+
+/* Open an anonymous file in dir, removed once it is closed */
+static int open_spill_file(const char *dir, FILE **d_file) {
+    char *path;
+    FILE *file;
+    int err;
+    int fd;
+
+    path = malloc(strlen(dir) + sizeof(SPILL_TEMPLATE));
+    if (!path) {
+        return errno;
+    }
+    strcpy(path, dir);
+    strcat(path, SPILL_TEMPLATE);
+
+    fd = mkstemp(path);
+    if (fd < 0) {
+        err = errno;
+        free(path);
+        return err;
+    }
+    unlink(path);
+    free(path);
+
+    file = fdopen(fd, "w+b");
+    if (!file) {
+        err = errno;
+        close(fd);
+        return err;
+    }
+
+    /* setvbuf only fails for invalid modes, fall back to the default */
+    setvbuf(file, NULL, _IOFBF, SPILL_BUFSIZE);
+    *d_file = file;
+    return 0;
+}
+
+static int alloc_run(const struct external_heap *eheap,
+                     struct spill_run **d_run) {
+    struct spill_run *run;
+    int err;
+
+    run = malloc(sizeof(*run) + 2 * eheap->esize);
+    if (!run) {
+        return errno;
+    }
+
+    err = open_spill_file(eheap->dir, &run->file);
+    if (err != 0) {
+        free(run);
+        return err;
+    }
+
+    *d_run = run;
+    return 0;
+}
+
+/* Rewind the written run and load its head, count elements were written */
+static int ds_eheap_finish_run(const struct external_heap *eheap,
+                               struct spill_run *run, size_t count) {
+    if (fflush(run->file) != 0 || fseeko(run->file, 0, SEEK_SET) != 0 ||
+        fread(run->head, eheap->esize, 1, run->file) != 1) {
+        return errno ? errno : EIO;
+    }
+
+    run->remaining = count - 1;
+    return 0;
+}
+
+/* Move the run at the root to its next element, dropping it when done */
+static int ds_eheap_advance_run(struct external_heap *eheap) {
+    struct spill_run **runs = get_runs(eheap);
+    struct spill_run *run = runs[0], *last;
+    size_t lost;
+
+    if (run->remaining > 0 &&
+        fread(run->head, eheap->esize, 1, run->file) == 1) {
+        run->remaining--;
+        runs_sift_down(eheap, runs, ds_da_len(&eheap->runs), 0);
+        return 0;
+    }
+
+    /* The run is finished (or unreadable), forget its elements */
+    lost = run->remaining;
+    eheap->len -= lost;
+    ds_da_pop(&eheap->runs, &last);
+    if (ds_da_len(&eheap->runs) > 0) {
+        runs[0] = last;
+        runs_sift_down(eheap, runs, ds_da_len(&eheap->runs), 0);
+    }
+    free_run(run);
+    return lost == 0 ? 0 : EIO;
+}
+
+/*
+ * Merge the MERGE_RUNS smallest runs into one. Merging the smallest keeps
+ * run sizes growing geometrically, so each element is only rewritten a
+ * logarithmic number of times. If the merge fails every run is rewound to
+ * where it started, so nothing is lost. Should rewinding fail too, the
+ * runs can no longer be trusted and the heap fails from then on.
+ */
+static int ds_eheap_merge_runs(struct external_heap *eheap) {
+    struct spill_run **runs = get_runs(eheap);
+    size_t nruns = ds_da_len(&eheap->runs);
+    struct spill_run **group = runs + nruns - MERGE_RUNS;
+    size_t esize = eheap->esize;
+    struct spill_run *merged;
+    size_t len, count;
+    int err;
+
+    err = alloc_run(eheap, &merged);
+    if (err != 0) {
+        return err;
+    }
+
+    qsort(runs, nruns, sizeof(*runs), sort_runs);
+    for (size_t i = 0; i < MERGE_RUNS; i++) {
+        group[i]->mark = ftello(group[i]->file);
+        if (group[i]->mark < 0) {
+            err = errno;
+            runs_heapify(eheap, runs, nruns);
+            free_run(merged);
+            return err;
+        }
+        group[i]->mark_remaining = group[i]->remaining;
+        memcpy(group[i]->head + esize, group[i]->head, esize);
+    }
+
+    /* Drained runs are swapped behind the heap, so none are dropped */
+    errno = 0;
+    count = 0;
+    len = MERGE_RUNS;
+    runs_heapify(eheap, group, len);
+    while (len > 0) {
+        struct spill_run *run = group[0];
+
+        if (fwrite(run->head, esize, 1, merged->file) != 1) {
+            break;
+        }
+        count++;
+
+        if (run->remaining > 0) {
+            if (fread(run->head, esize, 1, run->file) != 1) {
+                break;
+            }
+            run->remaining--;
+        } else {
+            group[0] = group[--len];
+            group[len] = run;
+        }
+        runs_sift_down(eheap, group, len, 0);
+    }
+
+    err = len > 0 ? (errno ? errno : EIO)
+                  : ds_eheap_finish_run(eheap, merged, count);
+    if (err != 0) {
+        for (size_t i = 0; i < MERGE_RUNS; i++) {
+            if (fseeko(group[i]->file, group[i]->mark, SEEK_SET) != 0) {
+                eheap->err = EIO;
+            }
+            group[i]->remaining = group[i]->mark_remaining;
+            memcpy(group[i]->head, group[i]->head + esize, esize);
+        }
+        runs_heapify(eheap, runs, nruns);
+        free_run(merged);
+        return err;
+    }
+
+    for (size_t i = 0; i < MERGE_RUNS; i++) {
+        free_run(group[i]);
+    }
+    group[0] = merged;
+    ds_da_truncate(&eheap->runs, nruns - MERGE_RUNS + 1);
+    runs_heapify(eheap, runs, ds_da_len(&eheap->runs));
+    return 0;
+}
+
+/*
+ * Write the whole in-memory heap to a new sorted run. The heap is only
+ * emptied once the run is safely written.
+ */
+static int ds_eheap_spill(struct external_heap *eheap) {
+    size_t count = ds_heap_len(eheap->heap);
+    struct spill_run *run;
+    int err;
+
+    if (ds_da_len(&eheap->runs) >= MAX_RUNS) {
+        err = ds_eheap_merge_runs(eheap);
+        if (err != 0) {
+            return err;
+        }
+    }
+
+    err = alloc_run(eheap, &run);
+    if (err != 0) {
+        return err;
+    }
+
+    /* A sorted array is still in heap order, should the write fail */
+    ds_heap_sort(eheap->heap);
+
+    errno = 0;
+    if (fwrite(ds_da_ptr(&eheap->heap->array, 0), eheap->esize, count,
+               run->file) != count) {
+        err = errno ? errno : EIO;
+    } else {
+        err = ds_eheap_finish_run(eheap, run, count);
+    }
+    if (err == 0) {
+        err = ds_da_append(&eheap->runs, &run);
+    }
+    if (err != 0) {
+        free_run(run);
+        return err;
+    }
+    runs_sift_up(eheap, get_runs(eheap), ds_da_len(&eheap->runs) - 1);
+
+    ds_heap_clear(eheap->heap);
+    return 0;
+}
+
+/*
+ * Find the run whose head is the minimum, or NULL if the minimum is in the
+ * heap. The heap min is loaded into eheap->element.
+ */
+static struct spill_run *ds_eheap_min_run(struct external_heap *eheap) {
+    bool in_memory;
+    struct spill_run *run;
+
+    in_memory = ds_heap_get_min(eheap->heap, eheap->element) == 0;
+    if (ds_da_len(&eheap->runs) == 0) {
+        return NULL;
+    }
+
+    run = get_runs(eheap)[0];
+    if (in_memory && eheap->cmp(run->head, eheap->element) >= 0) {
+        return NULL;
+    }
+    return run;
+}
+
+int ds_eheap_create(size_t esize, int (*cmp_method)(void *, void *),
+                    size_t budget, const char *dir,
+                    struct external_heap **d_eheap) {
+    struct external_heap *eheap;
+    int err;
+
+    if (esize == 0 || budget < esize) {
+        return EINVAL;
+    }
+
+    if (!dir) {
+        dir = getenv("TMPDIR");
+    }
+    if (!dir) {
+        dir = "/tmp";
+    }
+
+    eheap = malloc(sizeof(*eheap));
+    if (!eheap) {
+        return errno;
+    }
+
+    eheap->dir = strdup(dir);
+    eheap->element = malloc(esize);
+    if (!eheap->dir || !eheap->element) {
+        err = errno;
+        goto free_eheap;
+    }
+
+    err = ds_da_init(sizeof(struct spill_run *), &eheap->runs);
+    if (err != 0) {
+        goto free_eheap;
+    }
+
+    err = ds_heap_create(esize, cmp_method, &eheap->heap);
+    if (err != 0) {
+        free(eheap->runs.array);
+        goto free_eheap;
+    }
+
+    /* Sized once, one spare slot for swaps, so the heap never grows */
+    eheap->max_elements = budget / esize;
+    if (eheap->max_elements > SIZE_MAX / esize - 1) {
+        err = ENOMEM;
+        goto free_heap;
+    }
+    err = ds_da_reserve(&eheap->heap->array, eheap->max_elements + 1);
+    if (err != 0) {
+        goto free_heap;
+    }
+
+    eheap->cmp = cmp_method;
+    eheap->esize = esize;
+    eheap->len = 0;
+    eheap->err = 0;
+    *d_eheap = eheap;
+    return 0;
+
+free_heap:
+    ds_heap_free(eheap->heap);
+    free(eheap->runs.array);
+free_eheap:
+    free(eheap->dir);
+    free(eheap->element);
+    free(eheap);
+    return err;
+}
+
+int ds_eheap_add(struct external_heap *eheap, void *element) {
+    int err;
+
+    if (eheap->err != 0) {
+        return eheap->err;
+    }
+
+    if (ds_heap_len(eheap->heap) >= eheap->max_elements) {
+        err = ds_eheap_spill(eheap);
+        if (err != 0) {
+            return err;
+        }
+    }
+
+    err = ds_heap_add(eheap->heap, element);
+    if (err != 0) {
+        return err;
+    }
+
+    eheap->len++;
+    return 0;
+}
+
+int ds_eheap_get_min(struct external_heap *eheap, void *element) {
+    struct spill_run *run;
+
+    if (eheap->err != 0) {
+        return eheap->err;
+    }
+    if (eheap->len == 0) {
+        return EINVAL;
+    }
+
+    run = ds_eheap_min_run(eheap);
+    memcpy(element, run ? run->head : eheap->element, eheap->esize);
+    return 0;
+}
+
+int ds_eheap_pop_min(struct external_heap *eheap, void *min) {
+    struct spill_run *run;
+
+    if (eheap->err != 0) {
+        return eheap->err;
+    }
+    if (eheap->len == 0) {
+        return EINVAL;
+    }
+
+    run = ds_eheap_min_run(eheap);
+    eheap->len--;
+    if (!run) {
+        return ds_heap_pop_min(eheap->heap, min);
+    }
+
+    memcpy(min, run->head, eheap->esize);
+    return ds_eheap_advance_run(eheap);
+}
+
+void ds_eheap_free(struct external_heap *eheap) {
+    if (!eheap) {
+        return;
+    }
+
+    for (size_t i = 0; i < ds_da_len(&eheap->runs); i++) {
+        free_run(get_runs(eheap)[i]);
+    }
+    free(eheap->runs.array);
+    ds_heap_free(eheap->heap);
+    free(eheap->element);
+    free(eheap->dir);
+    free(eheap);
+}
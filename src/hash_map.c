@@ -0,0 +1,425 @@
+#include <data_structures.h>
+#include <errno.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define GROUP_WIDTH 16
+#define INITAL_GROUPS 1
+#define DEFAULT_MAX_LOAD 0.875f
+
+/* Control bytes: full slots hold the low 7 bits of the hash (H2) */
+#define CTRL_EMPTY ((int8_t)-128)
+#define CTRL_DELETED ((int8_t)-2)
+
+static inline uint64_t h1(uint64_t hash) { return hash >> 7; }
+
+static inline int8_t h2(uint64_t hash) { return (int8_t)(hash & 0x7f); }
+
+static inline bool ctrl_is_full(int8_t ctrl) { return ctrl >= 0; }
+
+static inline void *key_ptr(const struct hash_map *hm, size_t slot) {
+    return hm->slots + slot * hm->stride;
+}
+
+/* Values sit right after their key so a hit touches one cache line */
+static inline void *value_ptr(const struct hash_map *hm, size_t slot) {
+    return hm->slots + slot * hm->stride + hm->voffset;
+}
+
+/* Natural alignment of an object of size bytes, the lowest set bit */
+static inline size_t size_align(size_t size) {
+    size_t align = size & -size;
+
+    /* Nothing is stored for an empty value */
+    if (align == 0) {
+        return 1;
+    }
+    return align < alignof(max_align_t) ? align : alignof(max_align_t);
+}
+
+static inline size_t round_up(size_t n, size_t align) {
+    return (n + align - 1) & ~(align - 1);
+}
+
+/* Bitmask of the slots in the group whose control byte equals ctrl */
+static inline uint32_t group_match(const int8_t *group, int8_t ctrl) {
+#ifdef __SSE2__
+    __m128i g = _mm_load_si128((const __m128i *)group);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(ctrl)));
+#else
+    uint32_t mask = 0;
+
+    for (int i = 0; i < GROUP_WIDTH; i++) {
+        if (group[i] == ctrl) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/* Bitmask of the slots in the group that are empty or deleted */
+static inline uint32_t group_match_free(const int8_t *group) {
+#ifdef __SSE2__
+    __m128i g = _mm_load_si128((const __m128i *)group);
+    return _mm_movemask_epi8(g);
+#else
+    uint32_t mask = 0;
+
+    for (int i = 0; i < GROUP_WIDTH; i++) {
+        if (!ctrl_is_full(group[i])) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+static inline size_t max_entries(const struct hash_map *hm, size_t capacity) {
+    return (size_t)(capacity * hm->max_load);
+}
+
+/* Largest table whose slot array size fits in a size_t */
+static inline size_t max_capacity(const struct hash_map *hm) {
+    return SIZE_MAX / hm->stride;
+}
+
+static int capacity_for(const struct hash_map *hm, size_t n,
+                        size_t *capacity) {
+    size_t c = GROUP_WIDTH * INITAL_GROUPS;
+
+    while (max_entries(hm, c) < n) {
+        if (c > max_capacity(hm) / 2) {
+            return ENOMEM;
+        }
+        c *= 2;
+    }
+    *capacity = c;
+    return 0;
+}
+
+static int alloc_table(struct hash_map *hm, size_t capacity) {
+    void *ctrl;
+    int err;
+
+    if (capacity > max_capacity(hm)) {
+        return ENOMEM;
+    }
+
+    err = posix_memalign(&ctrl, GROUP_WIDTH, capacity);
+    if (err != 0) {
+        return err;
+    }
+
+    hm->slots = malloc(capacity * hm->stride);
+    if (!hm->slots) {
+        err = errno;
+        free(ctrl);
+        return err;
+    }
+
+    memset(ctrl, CTRL_EMPTY, capacity);
+    hm->ctrl = ctrl;
+    hm->capacity = capacity;
+    hm->growth_left = max_entries(hm, capacity);
+    return 0;
+}
+
+/*
+ * Triangular probing over groups; visits every group once since the number
+ * of groups is a power of two.
+ */
+static bool find_slot(const struct hash_map *hm, void *key, uint64_t hash,
+                      size_t *slot) {
+    size_t gmask = hm->capacity / GROUP_WIDTH - 1;
+    size_t group = h1(hash) & gmask;
+    int8_t tag = h2(hash);
+
+    for (size_t step = 1;; step++) {
+        const int8_t *ctrl = hm->ctrl + group * GROUP_WIDTH;
+        uint32_t match;
+
+        for (match = group_match(ctrl, tag); match; match &= match - 1) {
+            size_t s = group * GROUP_WIDTH + __builtin_ctz(match);
+
+            if (hm->eq(key, key_ptr(hm, s)) == 0) {
+                *slot = s;
+                return true;
+            }
+        }
+
+        if (group_match(ctrl, CTRL_EMPTY)) {
+            return false;
+        }
+        group = (group + step) & gmask;
+    }
+}
+
+/* Find the first empty or deleted slot along the probe sequence of hash */
+static size_t find_free_slot(const struct hash_map *hm, uint64_t hash) {
+    size_t gmask = hm->capacity / GROUP_WIDTH - 1;
+    size_t group = h1(hash) & gmask;
+
+    for (size_t step = 1;; step++) {
+        uint32_t match = group_match_free(hm->ctrl + group * GROUP_WIDTH);
+
+        if (match) {
+            return group * GROUP_WIDTH + __builtin_ctz(match);
+        }
+        group = (group + step) & gmask;
+    }
+}
+
+static void place(struct hash_map *hm, size_t slot, uint64_t hash, void *key,
+                  void *value) {
+    if (hm->ctrl[slot] == CTRL_EMPTY) {
+        hm->growth_left--;
+    }
+    hm->ctrl[slot] = h2(hash);
+    memcpy(key_ptr(hm, slot), key, hm->ksize);
+    if (hm->vsize) {
+        memcpy(value_ptr(hm, slot), value, hm->vsize);
+    }
+    hm->len++;
+}
+
+static int ds_hm_rehash(struct hash_map *hm, size_t capacity) {
+    struct hash_map old = *hm;
+    int err;
+
+    err = alloc_table(hm, capacity);
+    if (err != 0) {
+        *hm = old;
+        return err;
+    }
+
+    hm->len = 0;
+    for (size_t s = 0; s < old.capacity; s++) {
+        uint64_t hash;
+        void *key;
+
+        if (!ctrl_is_full(old.ctrl[s])) {
+            continue;
+        }
+        key = key_ptr(&old, s);
+        hash = hm->hash(key);
+        place(hm, find_free_slot(hm, hash), hash, key, value_ptr(&old, s));
+    }
+
+    free(old.ctrl);
+    free(old.slots);
+    return 0;
+}
+
+/* Make room for one more entry, dropping tombstones or growing the table */
+static int ds_hm_make_room(struct hash_map *hm) {
+    if (hm->growth_left > 0) {
+        return 0;
+    }
+
+    /* Mostly tombstones, rebuild at the same size */
+    if (hm->len < max_entries(hm, hm->capacity) / 2) {
+        return ds_hm_rehash(hm, hm->capacity);
+    }
+    if (hm->capacity > max_capacity(hm) / 2) {
+        return ENOMEM;
+    }
+    return ds_hm_rehash(hm, hm->capacity * 2);
+}
+
+int ds_hm_create(size_t ksize, size_t vsize, ds_hash hash, ds_cmp eq,
+                 struct hash_map **d_hm) {
+    struct hash_map *hm;
+    int err;
+
+    if (ksize == 0) {
+        return EINVAL;
+    }
+
+    hm = malloc(sizeof(*hm));
+    if (!hm) {
+        return errno;
+    }
+
+    hm->ksize = ksize;
+    hm->vsize = vsize;
+    hm->voffset = round_up(ksize, size_align(vsize));
+    hm->stride = round_up(hm->voffset + vsize, size_align(ksize));
+    hm->hash = hash;
+    hm->eq = eq;
+    hm->max_load = DEFAULT_MAX_LOAD;
+    hm->len = 0;
+    err = alloc_table(hm, GROUP_WIDTH * INITAL_GROUPS);
+    if (err != 0) {
+        free(hm);
+        return err;
+    }
+
+    *d_hm = hm;
+    return 0;
+}
+
+int ds_hm_set_max_load(struct hash_map *hm, float max_load) {
+    float old_load = hm->max_load;
+    size_t capacity, used;
+    int err;
+
+    if (!(max_load > 0.0f && max_load < 1.0f)) {
+        return EINVAL;
+    }
+
+    hm->max_load = max_load;
+    if (max_entries(hm, hm->capacity) <= hm->len) {
+        err = capacity_for(hm, hm->len + 1, &capacity);
+        if (err == 0) {
+            err = ds_hm_rehash(hm, capacity);
+        }
+        if (err != 0) {
+            hm->max_load = old_load;
+        }
+        return err;
+    }
+
+    /* Recount the budget, tombstones still occupy slots */
+    used = 0;
+    for (size_t s = 0; s < hm->capacity; s++) {
+        used += hm->ctrl[s] != CTRL_EMPTY;
+    }
+    if (used >= max_entries(hm, hm->capacity)) {
+        return ds_hm_rehash(hm, hm->capacity);
+    }
+    hm->growth_left = max_entries(hm, hm->capacity) - used;
+    return 0;
+}
+
+int ds_hm_reserve(struct hash_map *hm, size_t n) {
+    size_t capacity;
+    int err;
+
+    if (n <= hm->len + hm->growth_left) {
+        return 0;
+    }
+
+    err = capacity_for(hm, n, &capacity);
+    if (err != 0) {
+        return err;
+    }
+    return ds_hm_rehash(hm, capacity);
+}
+
+int ds_hm_insert(struct hash_map *hm, void *key, void *value) {
+    uint64_t hash;
+    size_t slot;
+    int err;
+
+    hash = hm->hash(key);
+    if (find_slot(hm, key, hash, &slot)) {
+        if (hm->vsize) {
+            memcpy(value_ptr(hm, slot), value, hm->vsize);
+        }
+        return 0;
+    }
+
+    err = ds_hm_make_room(hm);
+    if (err != 0) {
+        return err;
+    }
+
+    place(hm, find_free_slot(hm, hash), hash, key, value);
+    return 0;
+}
+
+int ds_hm_insert_bulk(struct hash_map *hm, void *keys, void *values,
+                      size_t n) {
+    char *k = keys, *v = values;
+    int err;
+
+    if (n > SIZE_MAX - hm->len) {
+        return ENOMEM;
+    }
+    err = ds_hm_reserve(hm, hm->len + n);
+    if (err != 0) {
+        return err;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        err = ds_hm_insert(hm, k + i * hm->ksize,
+                           hm->vsize ? v + i * hm->vsize : NULL);
+        if (err != 0) {
+            return err;
+        }
+    }
+    return 0;
+}
+
+int ds_hm_get(const struct hash_map *hm, void *key, void *value) {
+    size_t slot;
+
+    if (!find_slot(hm, key, hm->hash(key), &slot)) {
+        return ENOENT;
+    }
+
+    if (value && hm->vsize) {
+        memcpy(value, value_ptr(hm, slot), hm->vsize);
+    }
+    return 0;
+}
+
+int ds_hm_erase(struct hash_map *hm, void *key) {
+    size_t slot, group;
+
+    if (!find_slot(hm, key, hm->hash(key), &slot)) {
+        return ENOENT;
+    }
+
+    /*
+     * A group that still has an empty slot never stopped a probe, so no
+     * later entry depends on this slot and it can be marked empty again.
+     */
+    group = slot - slot % GROUP_WIDTH;
+    if (group_match(hm->ctrl + group, CTRL_EMPTY)) {
+        hm->ctrl[slot] = CTRL_EMPTY;
+        hm->growth_left++;
+    } else {
+        hm->ctrl[slot] = CTRL_DELETED;
+    }
+    hm->len--;
+    return 0;
+}
+
+int ds_hm_next(const struct hash_map *hm, size_t *iter, void *key,
+               void *value) {
+    for (size_t s = *iter; s < hm->capacity; s++) {
+        if (!ctrl_is_full(hm->ctrl[s])) {
+            continue;
+        }
+
+        if (key) {
+            memcpy(key, key_ptr(hm, s), hm->ksize);
+        }
+        if (value && hm->vsize) {
+            memcpy(value, value_ptr(hm, s), hm->vsize);
+        }
+        *iter = s + 1;
+        return 0;
+    }
+
+    *iter = hm->capacity;
+    return ENOENT;
+}
+
+void ds_hm_free(struct hash_map *hm) {
+    if (!hm) {
+        return;
+    }
+    free(hm->ctrl);
+    free(hm->slots);
+    free(hm);
+}
@@ -1,13 +1,20 @@
 #include <data_structures.h>
 #include <errno.h>
-#include <math.h>
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include "internal.h"
 
+/*
+ * Rebuild once sifting the batch up would cost this many heap lengths. With
+ * descending keys heap.bench puts the crossover at about 1.
+ */
+#define REBUILD_COST 1
+
 static size_t ds_heap_find_parent_index(size_t cindex) {
-    return (size_t)floor((cindex) / 2);
+    return (cindex - 1) / 2;
 }
 
 static int ds_heap_min_child(const struct heap *heap, size_t pindex,
@@ -70,6 +77,40 @@ static size_t ds_heap_bubble_down(struct heap *heap, size_t pindex) {
     return ds_heap_bubble_down(heap, cindex);
 }
 
+/* Floyd's bottom-up heap construction over the whole array */
+static void ds_heap_heapify(struct heap *heap) {
+    for (size_t pindex = ds_da_len(&heap->array) / 2; pindex > 0; pindex--) {
+        ds_heap_bubble_down(heap, pindex - 1);
+    }
+}
+
+/*
+ * Merge the elements appended since the last flush into the heap. Each one
+ * is sifted up in insertion order, which leaves the array exactly as
+ * unbuffered adds would have. If the caller allowed it, a batch whose sift
+ * ups would cost more than REBUILD_COST times the heap length rebuilds the
+ * whole heap in O(n) instead.
+ */
+static void ds_heap_flush(struct heap *heap) {
+    size_t len = ds_da_len(&heap->array);
+    size_t pending = len - heap->heapified;
+
+    if (pending == 0) {
+        return;
+    }
+
+    if (heap->rebuild &&
+        pending * (sizeof(long) * CHAR_BIT - __builtin_clzl(len)) >
+            REBUILD_COST * len) {
+        ds_heap_heapify(heap);
+    } else {
+        for (size_t cindex = heap->heapified; cindex < len; cindex++) {
+            ds_heap_bubble_up(heap, cindex);
+        }
+    }
+    heap->heapified = len;
+}
+
 int ds_heap_create(size_t esize, int (*cmp_method)(void *, void *),
                    struct heap **d_heap) {
     struct heap *heap;
@@ -102,6 +143,9 @@ int ds_heap_create(size_t esize, int (*cmp_method)(void *, void *),
     }
 
     heap->cmp = cmp_method;
+    heap->heapified = 0;
+    heap->buffer_max = 0;
+    heap->rebuild = false;
     *d_heap = heap;
     return 0;
 }
@@ -114,17 +158,34 @@ int ds_heap_add(struct heap *heap, void *element) {
         return err;
     }
 
-    ds_heap_bubble_up(heap, ds_da_len(&heap->array) - 1);
+    if (heap->buffer_max == 0) {
+        ds_heap_bubble_up(heap, ds_da_len(&heap->array) - 1);
+        heap->heapified++;
+    } else if (ds_da_len(&heap->array) - heap->heapified >=
+               heap->buffer_max) {
+        ds_heap_flush(heap);
+    }
     return 0;
 }
 
+void ds_heap_set_insert_buffer(struct heap *heap, size_t buffer_max,
+                               bool rebuild) {
+    heap->buffer_max = buffer_max;
+    heap->rebuild = rebuild;
+    if (ds_da_len(&heap->array) - heap->heapified >= buffer_max) {
+        ds_heap_flush(heap);
+    }
+}
+
 int ds_heap_get_min(struct heap *heap, void *element) {
+    ds_heap_flush(heap);
     return ds_da_get_value(&heap->array, 0, element);
 }
 
 int ds_heap_pop_min(struct heap *heap, void *min) {
     int err;
 
+    ds_heap_flush(heap);
     if (ds_da_len(&heap->array) > 0) {
         ds_da_swap(&heap->array, 0, ds_da_len(&heap->array) - 1);
     }
@@ -135,15 +196,81 @@ int ds_heap_pop_min(struct heap *heap, void *min) {
         return err;
     }
 
+    heap->heapified--;
     if (ds_da_len(&heap->array) > 0) {
         ds_heap_bubble_down(heap, 0);
     }
     return 0;
 }
 
+/*
+ * Place heap->element1 into the hole at the root of the first len elements.
+ * The hole is walked down to a leaf along the smaller children first, then
+ * the element climbs back up. Heapsort moves the last leaf to the root, which
+ * almost always belongs near the bottom, so this saves a comparison a level.
+ */
+static void ds_heap_fill_root(struct heap *heap, size_t len) {
+    size_t esize = heap->array.esize;
+    size_t pindex, cindex = 0;
+
+    for (pindex = 0; (cindex = 2 * pindex + 1) < len; pindex = cindex) {
+        if (cindex + 1 < len &&
+            heap->cmp(ds_da_ptr(&heap->array, cindex + 1),
+                      ds_da_ptr(&heap->array, cindex)) < 0) {
+            cindex++;
+        }
+        memcpy(ds_da_ptr(&heap->array, pindex),
+               ds_da_ptr(&heap->array, cindex), esize);
+    }
+
+    for (cindex = pindex; cindex > 0; cindex = pindex) {
+        pindex = ds_heap_find_parent_index(cindex);
+        if (heap->cmp(heap->element1, ds_da_ptr(&heap->array, pindex)) >= 0) {
+            break;
+        }
+        memcpy(ds_da_ptr(&heap->array, cindex),
+               ds_da_ptr(&heap->array, pindex), esize);
+    }
+    memcpy(ds_da_ptr(&heap->array, cindex), heap->element1, esize);
+}
+
+static void ds_heap_exchange(struct heap *heap, size_t idx1, size_t idx2) {
+    size_t esize = heap->array.esize;
+
+    memcpy(heap->element2, ds_da_ptr(&heap->array, idx1), esize);
+    memcpy(ds_da_ptr(&heap->array, idx1), ds_da_ptr(&heap->array, idx2),
+           esize);
+    memcpy(ds_da_ptr(&heap->array, idx2), heap->element2, esize);
+}
+
+void ds_heap_sort(struct heap *heap) {
+    size_t len;
+
+    ds_heap_flush(heap);
+    len = ds_da_len(&heap->array);
+
+    /* Heapsort moves each minimum behind the heap, leaving it descending */
+    for (size_t end = len; end > 1; end--) {
+        memcpy(heap->element1, ds_da_ptr(&heap->array, end - 1),
+               heap->array.esize);
+        memcpy(ds_da_ptr(&heap->array, end - 1), ds_da_ptr(&heap->array, 0),
+               heap->array.esize);
+        ds_heap_fill_root(heap, end - 1);
+    }
+
+    for (size_t idx = 0; idx < len / 2; idx++) {
+        ds_heap_exchange(heap, idx, len - 1 - idx);
+    }
+}
+
+void ds_heap_clear(struct heap *heap) {
+    ds_da_truncate(&heap->array, 0);
+    heap->heapified = 0;
+}
+
 void ds_heap_free(struct heap *heap) {
     if (heap) {
-        free(heap->array.array);
+        ds_mem_free(&heap->array);
         free(heap->element1);
         free(heap->element2);
         free(heap);
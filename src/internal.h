@@ -5,4 +5,25 @@
 
 int ds_da_init(size_t esize, struct dynamic_array *da);
 
+/* Grow the array to hold at least psize elements, it never shrinks */
+int ds_da_reserve(struct dynamic_array *da, size_t psize);
+
+/* Drop the elements from len onwards, clearing them like ds_da_pop() */
+void ds_da_truncate(struct dynamic_array *da, size_t len);
+
+char *ds_mem_realloc(struct dynamic_array *da, size_t old_bytes,
+                     size_t new_bytes);
+
+void ds_mem_free(struct dynamic_array *da);
+
+/* Sort the heap's array ascending in place, which keeps it in heap order */
+void ds_heap_sort(struct heap *heap);
+
+/* Remove every element from the heap */
+void ds_heap_clear(struct heap *heap);
+
+static inline void *ds_da_ptr(const struct dynamic_array *da, size_t idx) {
+    return da->array + idx * da->esize;
+}
+
 #endif /* __INTERNAL_H__ */
\ No newline at end of file
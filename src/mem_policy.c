@@ -0,0 +1,239 @@
+/* madvise(), mremap() and syscall() are not part of POSIX */
+#define _GNU_SOURCE
+#include <data_structures.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "internal.h"
+
+#define HUGE_PAGE_SIZE (2UL << 20)
+#define ALIGN_UP(N, A) (((N) + (A)-1) / (A) * (A))
+#define ALIGN_DOWN(N, A) ((N) / (A) * (A))
+
+/* From <linux/mempolicy.h>, which libc does not wrap */
+#define DS_MPOL_BIND 2
+#define DS_MPOL_INTERLEAVE 3
+#define DS_MPOL_MF_MOVE (1 << 1)
+
+#define NUMA_FLAGS (DS_MEM_NUMA_BIND | DS_MEM_NUMA_INTERLEAVE)
+
+#ifdef __linux__
+static unsigned int ds_mem_place(const struct ds_mem_policy *policy,
+                                 char *start, size_t len) {
+    unsigned int applied = 0;
+
+#ifdef MADV_HUGEPAGE
+    if ((policy->flags & DS_MEM_HUGEPAGE_ADVISE) &&
+        madvise(start, len, MADV_HUGEPAGE) == 0) {
+        applied |= DS_MEM_HUGEPAGE_ADVISE;
+    }
+#endif
+
+#ifdef SYS_mbind
+    if (policy->flags & NUMA_FLAGS) {
+        unsigned long mode = (policy->flags & DS_MEM_NUMA_BIND)
+                                 ? DS_MPOL_BIND
+                                 : DS_MPOL_INTERLEAVE;
+
+        /* The kernel reads one bit less than maxnode */
+        if (syscall(SYS_mbind, start, len, mode, &policy->nodemask,
+                    sizeof(policy->nodemask) * 8 + 1, DS_MPOL_MF_MOVE) == 0) {
+            applied |= policy->flags & NUMA_FLAGS;
+        }
+    }
+#endif
+    return applied;
+}
+#endif
+
+/*
+ * Memory under a policy is mapped on its own rather than taken from
+ * malloc(), so the advice and NUMA policy of its pages are dropped with
+ * the mapping instead of lingering on memory malloc() later hands out.
+ */
+static inline bool is_mapped(const struct ds_mem_policy *policy) {
+#ifdef __linux__
+    return policy->flags != 0;
+#else
+    return false;
+#endif
+}
+
+#ifdef __linux__
+/* Length of the mapping holding bytes, 0 if it cannot be represented */
+static size_t map_len(const struct ds_mem_policy *policy, size_t bytes) {
+    size_t align = (policy->flags & DS_MEM_HUGEPAGE_ALIGN)
+                       ? HUGE_PAGE_SIZE
+                       : (size_t)sysconf(_SC_PAGESIZE);
+
+    if (bytes == 0 || bytes > SIZE_MAX - align) {
+        return 0;
+    }
+    return ALIGN_UP(bytes, align);
+}
+
+/* Map len bytes, aligned to a huge page if the policy asks for it */
+static char *ds_mem_map(const struct ds_mem_policy *policy, size_t len,
+                        unsigned int *applied) {
+    int prot = PROT_READ | PROT_WRITE;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    char *map = MAP_FAILED;
+
+    *applied = 0;
+    if ((policy->flags & DS_MEM_HUGEPAGE_ALIGN) &&
+        len <= SIZE_MAX - HUGE_PAGE_SIZE) {
+        map = mmap(NULL, len + HUGE_PAGE_SIZE, prot, flags, -1, 0);
+        if (map != MAP_FAILED) {
+            char *start = (char *)ALIGN_UP((uintptr_t)map, HUGE_PAGE_SIZE);
+
+            /* Trim the unaligned head and the tail */
+            if (start > map) {
+                munmap(map, start - map);
+            }
+            munmap(start + len, map + HUGE_PAGE_SIZE - start);
+            *applied |= DS_MEM_HUGEPAGE_ALIGN;
+            map = start;
+        }
+    }
+
+    if (map == MAP_FAILED) {
+        map = mmap(NULL, len, prot, flags, -1, 0);
+        if (map == MAP_FAILED) {
+            return NULL;
+        }
+    }
+
+    /* Place pages before anything first touches them */
+    *applied |= ds_mem_place(policy, map, len);
+    return map;
+}
+#endif
+
+/* Allocate a new block of bytes under policy */
+static char *ds_mem_alloc(const struct ds_mem_policy *policy, size_t bytes,
+                          unsigned int *applied) {
+#ifdef __linux__
+    if (is_mapped(policy)) {
+        size_t len = map_len(policy, bytes);
+
+        if (len == 0) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        return ds_mem_map(policy, len, applied);
+    }
+#endif
+    *applied = 0;
+    return malloc(bytes);
+}
+
+static void ds_mem_release(const struct ds_mem_policy *policy, char *array,
+                           size_t bytes) {
+#ifdef __linux__
+    if (is_mapped(policy)) {
+        munmap(array, map_len(policy, bytes));
+        return;
+    }
+#endif
+    free(array);
+}
+
+/*
+ * Resize the array's block under its placement policy. A plain block goes
+ * through realloc(). A mapped block is grown with mremap(), which moves
+ * page tables rather than copying, and only the new pages are placed. A
+ * huge page aligned block that cannot grow in place is moved to a fresh
+ * aligned mapping, as mremap() could lose the alignment.
+ */
+char *ds_mem_realloc(struct dynamic_array *da, size_t old_bytes,
+                     size_t new_bytes) {
+#ifdef __linux__
+    const struct ds_mem_policy *policy = &da->policy;
+    size_t old_len, new_len;
+    unsigned int applied;
+    char *array;
+
+    if (!is_mapped(policy)) {
+        return realloc(da->array, new_bytes);
+    }
+
+    old_len = map_len(policy, old_bytes);
+    new_len = map_len(policy, new_bytes);
+    if (new_len == 0) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (new_len == old_len) {
+        return da->array;
+    }
+
+    array = mremap(da->array, old_len, new_len, 0);
+    if (array == MAP_FAILED && !(policy->flags & DS_MEM_HUGEPAGE_ALIGN)) {
+        array = mremap(da->array, old_len, new_len, MREMAP_MAYMOVE);
+    }
+    if (array != MAP_FAILED) {
+        if (new_len > old_len) {
+            applied =
+                ds_mem_place(policy, array + old_len, new_len - old_len);
+            da->policy_applied &= applied | DS_MEM_HUGEPAGE_ALIGN;
+        }
+        return array;
+    }
+
+    array = ds_mem_map(policy, new_len, &applied);
+    if (!array) {
+        return NULL;
+    }
+    memcpy(array, da->array, old_bytes < new_bytes ? old_bytes : new_bytes);
+    munmap(da->array, old_len);
+    da->policy_applied = applied;
+    return array;
+#else
+    return realloc(da->array, new_bytes);
+#endif
+}
+
+void ds_mem_free(struct dynamic_array *da) {
+    ds_mem_release(&da->policy, da->array, da->psize * da->esize);
+}
+
+int ds_da_set_mem_policy(struct dynamic_array *da,
+                         const struct ds_mem_policy *policy) {
+    size_t bytes = da->psize * da->esize;
+    unsigned int applied;
+    char *array;
+
+    if ((policy->flags & ~DS_MEM_ALL) ||
+        (policy->flags & NUMA_FLAGS) == NUMA_FLAGS ||
+        ((policy->flags & NUMA_FLAGS) && policy->nodemask == 0)) {
+        return EINVAL;
+    }
+
+    /* Move the existing elements to a fresh block under the new policy */
+    array = ds_mem_alloc(policy, bytes, &applied);
+    if (!array) {
+        return errno;
+    }
+    memcpy(array, da->array, bytes);
+    ds_mem_release(&da->policy, da->array, bytes);
+
+    da->array = array;
+    da->policy = *policy;
+    da->policy_applied = applied;
+    return 0;
+}
+
+void ds_da_mem_stats(const struct dynamic_array *da,
+                     struct ds_mem_stats *stats) {
+    stats->requested = da->policy.flags;
+    stats->applied = da->policy_applied;
+    stats->bytes = da->psize * da->esize;
+}
@@ -0,0 +1,167 @@
+#include <data_structures.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "internal.h"
+
+static inline bool run_exhausted(const struct merge *merge, size_t run) {
+    return merge->pos[run] >= ds_da_len(merge->runs[run]);
+}
+
+static inline void *run_head(const struct merge *merge, size_t run) {
+    return ds_da_ptr(merge->runs[run], merge->pos[run]);
+}
+
+/*
+ * Whether the head of run a is output before the head of run b. Exhausted
+ * runs lose every match and ties go to the lower run to keep the merge
+ * stable.
+ */
+static bool beats(const struct merge *merge, size_t a, size_t b) {
+    int cmp;
+
+    if (run_exhausted(merge, a)) {
+        return false;
+    }
+    if (run_exhausted(merge, b)) {
+        return true;
+    }
+
+    cmp = merge->cmp(run_head(merge, a), run_head(merge, b));
+    return cmp < 0 || (cmp == 0 && a < b);
+}
+
+/*
+ * The tree is laid out like a heap, with run i as leaf k + i. Internal
+ * node n keeps the loser of the match between its subtrees, and tree[0]
+ * keeps the overall winner.
+ */
+static int ds_merge_build(struct merge *merge) {
+    size_t k = merge->k;
+    size_t *winners;
+
+    winners = malloc(2 * k * sizeof(*winners));
+    if (!winners) {
+        return errno;
+    }
+
+    for (size_t i = 0; i < k; i++) {
+        winners[k + i] = i;
+    }
+    for (size_t node = k - 1; node > 0; node--) {
+        size_t left = winners[2 * node], right = winners[2 * node + 1];
+
+        if (beats(merge, left, right)) {
+            winners[node] = left;
+            merge->tree[node] = right;
+        } else {
+            winners[node] = right;
+            merge->tree[node] = left;
+        }
+    }
+    merge->tree[0] = k > 1 ? winners[1] : 0;
+
+    free(winners);
+    return 0;
+}
+
+/* Advance the winning run and replay its path to the root */
+static void ds_merge_replay(struct merge *merge) {
+    size_t winner = merge->tree[0];
+
+    merge->pos[winner]++;
+    for (size_t node = (winner + merge->k) / 2; node > 0; node /= 2) {
+        if (beats(merge, merge->tree[node], winner)) {
+            size_t loser = winner;
+
+            winner = merge->tree[node];
+            merge->tree[node] = loser;
+        }
+    }
+    merge->tree[0] = winner;
+}
+
+int ds_merge_create(struct dynamic_array **runs, size_t k,
+                    int (*cmp_method)(void *, void *),
+                    struct merge **d_merge) {
+    struct merge *merge;
+    size_t remaining;
+    int err;
+
+    if (k == 0) {
+        return EINVAL;
+    }
+
+    remaining = 0;
+    for (size_t i = 0; i < k; i++) {
+        if (runs[i]->esize != runs[0]->esize) {
+            return EINVAL;
+        }
+        remaining += ds_da_len(runs[i]);
+    }
+
+    merge = malloc(sizeof(*merge));
+    if (!merge) {
+        return errno;
+    }
+
+    merge->runs = malloc(k * sizeof(*merge->runs));
+    merge->pos = calloc(k, sizeof(*merge->pos));
+    merge->tree = malloc(k * sizeof(*merge->tree));
+    if (!merge->runs || !merge->pos || !merge->tree) {
+        err = errno;
+        goto free_merge;
+    }
+
+    memcpy(merge->runs, runs, k * sizeof(*merge->runs));
+    merge->cmp = cmp_method;
+    merge->k = k;
+    merge->esize = runs[0]->esize;
+    merge->remaining = remaining;
+
+    err = ds_merge_build(merge);
+    if (err != 0) {
+        goto free_merge;
+    }
+
+    *d_merge = merge;
+    return 0;
+
+free_merge:
+    free(merge->runs);
+    free(merge->pos);
+    free(merge->tree);
+    free(merge);
+    return err;
+}
+
+int ds_merge_next_n(struct merge *merge, void *elements, size_t n,
+                    size_t *written) {
+    char *out = elements;
+    size_t i;
+
+    if (n > merge->remaining) {
+        n = merge->remaining;
+    }
+
+    for (i = 0; i < n; i++) {
+        memcpy(out + i * merge->esize, run_head(merge, merge->tree[0]),
+               merge->esize);
+        ds_merge_replay(merge);
+    }
+
+    merge->remaining -= n;
+    *written = n;
+    return 0;
+}
+
+void ds_merge_free(struct merge *merge) {
+    if (merge) {
+        free(merge->runs);
+        free(merge->pos);
+        free(merge->tree);
+        free(merge);
+    }
+}
@@ -0,0 +1,268 @@
+#include <data_structures.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "internal.h"
+
+static inline void *get_ptr(const struct mmheap *heap, size_t idx) {
+    return ds_da_ptr(&heap->array, idx);
+}
+
+/* Normalised to -1, 0 or 1, so flipping it for max levels cannot overflow */
+static inline int cmp_idx(const struct mmheap *heap, size_t idx1,
+                          size_t idx2) {
+    int cmp = heap->cmp(get_ptr(heap, idx1), get_ptr(heap, idx2));
+
+    return (cmp > 0) - (cmp < 0);
+}
+
+static void swap(struct mmheap *heap, size_t idx1, size_t idx2) {
+    size_t esize = heap->array.esize;
+
+    memcpy(heap->element, get_ptr(heap, idx1), esize);
+    memcpy(get_ptr(heap, idx1), get_ptr(heap, idx2), esize);
+    memcpy(get_ptr(heap, idx2), heap->element, esize);
+}
+
+static inline size_t parent(size_t idx) { return (idx - 1) / 2; }
+
+/* Even levels, starting with the root, are min levels */
+static bool is_min_level(size_t idx) {
+    unsigned int level = 0;
+
+    for (idx++; idx > 1; idx /= 2) {
+        level++;
+    }
+    return level % 2 == 0;
+}
+
+/*
+ * Move the element at idx up through the levels of its own kind. dir is 1
+ * on min levels and -1 on max levels, flipping the comparisons.
+ */
+static void ds_mmheap_push_up_level(struct mmheap *heap, size_t idx,
+                                    int dir) {
+    while (idx > 2) {
+        size_t gindex = parent(parent(idx));
+
+        if (dir * cmp_idx(heap, idx, gindex) >= 0) {
+            break;
+        }
+        swap(heap, idx, gindex);
+        idx = gindex;
+    }
+}
+
+static void ds_mmheap_push_up(struct mmheap *heap, size_t idx) {
+    int dir = is_min_level(idx) ? 1 : -1;
+    size_t pindex;
+
+    if (idx == 0) {
+        return;
+    }
+
+    pindex = parent(idx);
+    if (dir * cmp_idx(heap, idx, pindex) > 0) {
+        swap(heap, idx, pindex);
+        ds_mmheap_push_up_level(heap, pindex, -dir);
+    } else {
+        ds_mmheap_push_up_level(heap, idx, dir);
+    }
+}
+
+/*
+ * Move the element at idx down, swapping with the smallest (dir 1) or
+ * largest (dir -1) of its children and grandchildren.
+ */
+static void ds_mmheap_push_down(struct mmheap *heap, size_t idx) {
+    int dir = is_min_level(idx) ? 1 : -1;
+    size_t len = ds_da_len(&heap->array);
+
+    for (;;) {
+        size_t first = 2 * idx + 1;
+        size_t best = first;
+
+        if (first >= len) {
+            return;
+        }
+
+        /* Children, then the up to four grandchildren */
+        if (first + 1 < len && dir * cmp_idx(heap, first + 1, best) < 0) {
+            best = first + 1;
+        }
+        for (size_t g = 2 * first + 1; g < 2 * first + 5 && g < len; g++) {
+            if (dir * cmp_idx(heap, g, best) < 0) {
+                best = g;
+            }
+        }
+
+        if (dir * cmp_idx(heap, best, idx) >= 0) {
+            return;
+        }
+        swap(heap, best, idx);
+
+        if (best <= first + 1) {
+            return;
+        }
+
+        /* A grandchild moved, it may now be out of order with its parent */
+        if (dir * cmp_idx(heap, best, parent(best)) > 0) {
+            swap(heap, best, parent(best));
+        }
+        idx = best;
+    }
+}
+
+static size_t ds_mmheap_max_index(const struct mmheap *heap) {
+    size_t len = ds_da_len(&heap->array);
+
+    if (len <= 2) {
+        return len - 1;
+    }
+    return cmp_idx(heap, 1, 2) >= 0 ? 1 : 2;
+}
+
+/* Remove the element at idx, filling the hole with the last element */
+static void ds_mmheap_remove(struct mmheap *heap, size_t idx,
+                             void *element) {
+    size_t last = ds_da_len(&heap->array) - 1;
+
+    if (element) {
+        memcpy(element, get_ptr(heap, idx), heap->array.esize);
+    }
+
+    if (idx != last) {
+        memcpy(get_ptr(heap, idx), get_ptr(heap, last), heap->array.esize);
+    }
+    ds_da_pop(&heap->array, NULL);
+
+    if (idx < last) {
+        ds_mmheap_push_down(heap, idx);
+    }
+}
+
+int ds_mmheap_create(size_t esize, int (*cmp_method)(void *, void *),
+                     struct mmheap **d_heap) {
+    struct mmheap *heap;
+    int err;
+
+    heap = malloc(sizeof(*heap));
+    if (!heap) {
+        return errno;
+    }
+
+    heap->element = malloc(esize);
+    if (!heap->element) {
+        err = errno;
+        free(heap);
+        return err;
+    }
+
+    err = ds_da_init(esize, &heap->array);
+    if (err != 0) {
+        free(heap->element);
+        free(heap);
+        return err;
+    }
+
+    heap->cmp = cmp_method;
+    *d_heap = heap;
+    return 0;
+}
+
+int ds_mmheap_add(struct mmheap *heap, void *element) {
+    int err;
+
+    err = ds_da_append(&heap->array, element);
+    if (err != 0) {
+        return err;
+    }
+
+    ds_mmheap_push_up(heap, ds_da_len(&heap->array) - 1);
+    return 0;
+}
+
+int ds_mmheap_get_min(struct mmheap *heap, void *element) {
+    return ds_da_get_value(&heap->array, 0, element);
+}
+
+int ds_mmheap_get_max(struct mmheap *heap, void *element) {
+    if (ds_da_len(&heap->array) == 0) {
+        return EINVAL;
+    }
+    return ds_da_get_value(&heap->array, ds_mmheap_max_index(heap), element);
+}
+
+int ds_mmheap_pop_min(struct mmheap *heap, void *min) {
+    if (ds_da_len(&heap->array) == 0) {
+        return EINVAL;
+    }
+
+    ds_mmheap_remove(heap, 0, min);
+    return 0;
+}
+
+int ds_mmheap_pop_max(struct mmheap *heap, void *max) {
+    if (ds_da_len(&heap->array) == 0) {
+        return EINVAL;
+    }
+
+    ds_mmheap_remove(heap, ds_mmheap_max_index(heap), max);
+    return 0;
+}
+
+int ds_mmheap_push_bounded(struct mmheap *heap, void *element, size_t k,
+                           void *evicted, bool *d_evicted) {
+    size_t idx;
+    int err;
+
+    if (k == 0) {
+        return EINVAL;
+    }
+
+    /* A smaller bound than before drops the largest down to k */
+    while (ds_da_len(&heap->array) > k) {
+        ds_mmheap_remove(heap, ds_mmheap_max_index(heap), NULL);
+    }
+
+    if (ds_da_len(&heap->array) < k) {
+        err = ds_mmheap_add(heap, element);
+        if (err != 0) {
+            return err;
+        }
+        *d_evicted = false;
+        return 0;
+    }
+
+    /* Full, so either the new element or the max is the worst */
+    *d_evicted = true;
+    idx = ds_mmheap_max_index(heap);
+    if (heap->cmp(element, get_ptr(heap, idx)) >= 0) {
+        if (evicted) {
+            memcpy(evicted, element, heap->array.esize);
+        }
+        return 0;
+    }
+
+    if (evicted) {
+        memcpy(evicted, get_ptr(heap, idx), heap->array.esize);
+    }
+    memcpy(get_ptr(heap, idx), element, heap->array.esize);
+
+    /* The replacement may undercut the min at the root */
+    if (idx > 0 && cmp_idx(heap, idx, 0) < 0) {
+        swap(heap, idx, 0);
+    }
+    ds_mmheap_push_down(heap, idx);
+    return 0;
+}
+
+void ds_mmheap_free(struct mmheap *heap) {
+    if (heap) {
+        free(heap->array.array);
+        free(heap->element);
+        free(heap);
+    }
+}
@@ -0,0 +1,245 @@
+#include <data_structures.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#define INITAL_WORDS 4
+#define WORD_BITS 64
+
+static inline uint64_t value_mask(const struct packed_array *pa) {
+    return (1ULL << pa->width) - 1;
+}
+
+/* Number of words holding the first n elements */
+static inline size_t used_words(const struct packed_array *pa, size_t n) {
+    return (n * pa->width + WORD_BITS - 1) / WORD_BITS;
+}
+
+static inline uint16_t get_value(const struct packed_array *pa, size_t idx) {
+    size_t offset = idx * pa->width;
+    size_t word = offset / WORD_BITS;
+    unsigned int shift = offset % WORD_BITS;
+    uint64_t value;
+
+    value = pa->words[word] >> shift;
+    if (shift + pa->width > WORD_BITS) {
+        value |= pa->words[word + 1] << (WORD_BITS - shift);
+    }
+    return value & value_mask(pa);
+}
+
+static inline void set_value(struct packed_array *pa, size_t idx,
+                             uint64_t value) {
+    size_t offset = idx * pa->width;
+    size_t word = offset / WORD_BITS;
+    unsigned int shift = offset % WORD_BITS;
+    uint64_t mask = value_mask(pa);
+
+    pa->words[word] = (pa->words[word] & ~(mask << shift)) | value << shift;
+    if (shift + pa->width > WORD_BITS) {
+        unsigned int spill = WORD_BITS - shift;
+
+        pa->words[word + 1] =
+            (pa->words[word + 1] & ~(mask >> spill)) | value >> spill;
+    }
+}
+
+/* Grow by half again, capped at the most words that fit in a size_t */
+static int ds_pa_grow(struct packed_array *pa) {
+    size_t max_words = SIZE_MAX / sizeof(*pa->words);
+    size_t pwords;
+    uint64_t *words;
+
+    if (pa->pwords >= max_words) {
+        return ENOMEM;
+    }
+    pwords = pa->pwords + pa->pwords / 2 + 1;
+    if (pwords > max_words) {
+        pwords = max_words;
+    }
+
+    words = realloc(pa->words, pwords * sizeof(*words));
+    if (!words) {
+        return errno;
+    }
+
+    memset(words + pa->pwords, 0, (pwords - pa->pwords) * sizeof(*words));
+    pa->words = words;
+    pa->pwords = pwords;
+    return 0;
+}
+
+int ds_pa_create(unsigned int width, struct packed_array **d_pa) {
+    struct packed_array *pa;
+    int err;
+
+    if (width < 1 || width > 16) {
+        return EINVAL;
+    }
+
+    pa = malloc(sizeof(*pa));
+    if (!pa) {
+        return errno;
+    }
+
+    pa->words = calloc(INITAL_WORDS, sizeof(*pa->words));
+    if (!pa->words) {
+        err = errno;
+        free(pa);
+        return err;
+    }
+
+    pa->pwords = INITAL_WORDS;
+    pa->lsize = 0;
+    pa->width = width;
+    *d_pa = pa;
+    return 0;
+}
+
+int ds_pa_get_value(const struct packed_array *pa, size_t idx,
+                    uint16_t *value) {
+    if (idx >= pa->lsize) {
+        return EINVAL;
+    }
+
+    *value = get_value(pa, idx);
+    return 0;
+}
+
+int ds_pa_set_value(struct packed_array *pa, size_t idx, uint16_t value) {
+    if (idx >= pa->lsize || value > value_mask(pa)) {
+        return EINVAL;
+    }
+
+    set_value(pa, idx, value);
+    return 0;
+}
+
+int ds_pa_append(struct packed_array *pa, uint16_t value) {
+    if (value > value_mask(pa)) {
+        return EINVAL;
+    }
+
+    if (used_words(pa, pa->lsize + 1) > pa->pwords) {
+        int err;
+
+        err = ds_pa_grow(pa);
+        if (err != 0) {
+            return err;
+        }
+    }
+
+    set_value(pa, pa->lsize, value);
+    pa->lsize++;
+    return 0;
+}
+
+int ds_pa_pop(struct packed_array *pa, uint16_t *value) {
+    size_t idx;
+
+    if (pa->lsize == 0) {
+        return EINVAL;
+    }
+    idx = pa->lsize - 1;
+
+    if (value) {
+        *value = get_value(pa, idx);
+    }
+    /* Bits past the end stay clear for the word-level kernels */
+    set_value(pa, idx, 0);
+    pa->lsize--;
+    return 0;
+}
+
+size_t ds_pa_popcount(const struct packed_array *pa) {
+    size_t nwords = used_words(pa, pa->lsize);
+    size_t count = 0;
+
+    for (size_t i = 0; i < nwords; i++) {
+        count += __builtin_popcountll(pa->words[i]);
+    }
+    return count;
+}
+
+int ds_pa_find_first_set(const struct packed_array *pa, size_t start,
+                         size_t *idx) {
+    size_t nwords = used_words(pa, pa->lsize);
+    size_t offset = start * pa->width;
+    size_t word = offset / WORD_BITS;
+    uint64_t bits;
+
+    if (start >= pa->lsize) {
+        return ENOENT;
+    }
+
+    /*
+     * Elements are stored low bit first, so the first set bit belongs to
+     * the first non-zero element.
+     */
+    bits = pa->words[word] & (~0ULL << offset % WORD_BITS);
+    while (!bits) {
+        if (++word >= nwords) {
+            return ENOENT;
+        }
+        bits = pa->words[word];
+    }
+
+    *idx = (word * WORD_BITS + __builtin_ctzll(bits)) / pa->width;
+    return 0;
+}
+
+int ds_pa_rank(const struct packed_array *pa, size_t idx, size_t *rank) {
+    size_t word = idx / WORD_BITS;
+    size_t count = 0;
+
+    if (pa->width != 1 || idx > pa->lsize) {
+        return EINVAL;
+    }
+
+    for (size_t i = 0; i < word; i++) {
+        count += __builtin_popcountll(pa->words[i]);
+    }
+    if (idx % WORD_BITS) {
+        uint64_t mask = (1ULL << idx % WORD_BITS) - 1;
+
+        count += __builtin_popcountll(pa->words[word] & mask);
+    }
+
+    *rank = count;
+    return 0;
+}
+
+int ds_pa_select(const struct packed_array *pa, size_t rank, size_t *idx) {
+    size_t nwords = used_words(pa, pa->lsize);
+
+    if (pa->width != 1) {
+        return EINVAL;
+    }
+
+    for (size_t i = 0; i < nwords; i++) {
+        uint64_t bits = pa->words[i];
+        size_t count = __builtin_popcountll(bits);
+
+        if (rank >= count) {
+            rank -= count;
+            continue;
+        }
+
+        /* Drop the lower set bits of the word */
+        while (rank--) {
+            bits &= bits - 1;
+        }
+        *idx = i * WORD_BITS + __builtin_ctzll(bits);
+        return 0;
+    }
+    return ENOENT;
+}
+
+void ds_pa_free(struct packed_array *pa) {
+    if (!pa) {
+        return;
+    }
+    free(pa->words);
+    free(pa);
+}
@@ -0,0 +1,209 @@
+#include <data_structures.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "internal.h"
+
+#define ALIGN_UP(N, A) (((N) + (A)-1) / (A) * (A))
+
+static inline uint32_t get_slot(const struct split_heap *heap,
+                                const char *entry) {
+    uint32_t slot;
+
+    memcpy(&slot, entry + heap->soffset, sizeof(slot));
+    return slot;
+}
+
+static inline void *entry_ptr(const struct split_heap *heap, size_t idx) {
+    return ds_da_ptr(&heap->entries, idx);
+}
+
+/* Move parents down into the hole until the entry in heap->entry fits */
+static void ds_sheap_sift_up(struct split_heap *heap, size_t cindex) {
+    size_t esize = heap->entries.esize;
+
+    while (cindex > 0) {
+        size_t pindex = (cindex - 1) / 2;
+
+        if (heap->cmp(heap->entry, entry_ptr(heap, pindex)) >= 0) {
+            break;
+        }
+        memcpy(entry_ptr(heap, cindex), entry_ptr(heap, pindex), esize);
+        cindex = pindex;
+    }
+    memcpy(entry_ptr(heap, cindex), heap->entry, esize);
+}
+
+/* Move children up into the hole until the entry in heap->entry fits */
+static void ds_sheap_sift_down(struct split_heap *heap, size_t pindex) {
+    size_t len = ds_da_len(&heap->entries);
+    size_t esize = heap->entries.esize;
+
+    for (;;) {
+        size_t cindex = 2 * pindex + 1;
+
+        if (cindex >= len) {
+            break;
+        }
+        if (cindex + 1 < len && heap->cmp(entry_ptr(heap, cindex + 1),
+                                          entry_ptr(heap, cindex)) < 0) {
+            cindex++;
+        }
+        if (heap->cmp(heap->entry, entry_ptr(heap, cindex)) <= 0) {
+            break;
+        }
+        memcpy(entry_ptr(heap, pindex), entry_ptr(heap, cindex), esize);
+        pindex = cindex;
+    }
+    memcpy(entry_ptr(heap, pindex), heap->entry, esize);
+}
+
+int ds_sheap_create(size_t ksize, size_t psize,
+                    int (*cmp_method)(void *, void *),
+                    struct split_heap **d_heap) {
+    struct split_heap *heap;
+    size_t soffset, esize;
+    int err;
+
+    /* Keep the slot index, and 8-byte keys, naturally aligned */
+    soffset = ALIGN_UP(ksize, sizeof(uint32_t));
+    esize = soffset + sizeof(uint32_t);
+    if (ksize >= sizeof(uint64_t)) {
+        esize = ALIGN_UP(esize, sizeof(uint64_t));
+    }
+
+    heap = malloc(sizeof(*heap));
+    if (!heap) {
+        return errno;
+    }
+
+    heap->entry = malloc(esize);
+    if (!heap->entry) {
+        err = errno;
+        free(heap);
+        return err;
+    }
+
+    err = ds_da_init(esize, &heap->entries);
+    if (err != 0) {
+        goto free_entry;
+    }
+
+    err = ds_da_init(psize, &heap->payloads);
+    if (err != 0) {
+        goto free_entries;
+    }
+
+    err = ds_da_init(sizeof(uint32_t), &heap->free_slots);
+    if (err != 0) {
+        goto free_payloads;
+    }
+
+    memset(heap->entry, 0, esize);
+    heap->cmp = cmp_method;
+    heap->ksize = ksize;
+    heap->soffset = soffset;
+    *d_heap = heap;
+    return 0;
+
+free_payloads:
+    free(heap->payloads.array);
+free_entries:
+    free(heap->entries.array);
+free_entry:
+    free(heap->entry);
+    free(heap);
+    return err;
+}
+
+int ds_sheap_add(struct split_heap *heap, void *key, void *payload) {
+    size_t nfree = ds_da_len(&heap->free_slots);
+    uint32_t slot;
+    int err;
+
+    /* Reuse the last freed slot, popped only once nothing else can fail */
+    if (nfree > 0) {
+        ds_da_get_value(&heap->free_slots, nfree - 1, &slot);
+    } else if (ds_da_len(&heap->payloads) >= UINT32_MAX) {
+        return EOVERFLOW;
+    } else {
+        slot = ds_da_len(&heap->payloads);
+    }
+
+    memcpy(heap->entry, key, heap->ksize);
+    memcpy(heap->entry + heap->soffset, &slot, sizeof(slot));
+    err = ds_da_append(&heap->entries, heap->entry);
+    if (err != 0) {
+        return err;
+    }
+
+    if (nfree > 0) {
+        ds_da_pop(&heap->free_slots, NULL);
+        memcpy(ds_da_ptr(&heap->payloads, slot), payload,
+               heap->payloads.esize);
+    } else {
+        err = ds_da_append(&heap->payloads, payload);
+        if (err != 0) {
+            ds_da_pop(&heap->entries, NULL);
+            return err;
+        }
+    }
+
+    ds_sheap_sift_up(heap, ds_da_len(&heap->entries) - 1);
+    return 0;
+}
+
+int ds_sheap_get_min(struct split_heap *heap, void *key, void *payload) {
+    char *root;
+
+    if (ds_da_len(&heap->entries) == 0) {
+        return EINVAL;
+    }
+
+    root = entry_ptr(heap, 0);
+    if (key) {
+        memcpy(key, root, heap->ksize);
+    }
+    if (payload) {
+        memcpy(payload, ds_da_ptr(&heap->payloads, get_slot(heap, root)),
+               heap->payloads.esize);
+    }
+    return 0;
+}
+
+int ds_sheap_pop_min(struct split_heap *heap, void *key, void *payload) {
+    uint32_t slot;
+    size_t len;
+    int err;
+
+    len = ds_da_len(&heap->entries);
+    if (len == 0) {
+        return EINVAL;
+    }
+
+    /* Recording the free slot is the only step that can fail */
+    slot = get_slot(heap, entry_ptr(heap, 0));
+    err = ds_da_append(&heap->free_slots, &slot);
+    if (err != 0) {
+        return err;
+    }
+
+    ds_sheap_get_min(heap, key, payload);
+    ds_da_pop(&heap->entries, heap->entry);
+    if (len > 1) {
+        ds_sheap_sift_down(heap, 0);
+    }
+    return 0;
+}
+
+void ds_sheap_free(struct split_heap *heap) {
+    if (heap) {
+        free(heap->entries.array);
+        free(heap->payloads.array);
+        free(heap->free_slots.array);
+        free(heap->entry);
+        free(heap);
+    }
+}
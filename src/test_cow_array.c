@@ -0,0 +1,198 @@
+#include <assert.h>
+#include <data_structures.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <tap.h>
+
+#define ARRAY_LEN(A) (sizeof(A) / sizeof(*A))
+
+static int create(void) {
+    struct cow_array *ca = NULL;
+    int err;
+
+    err = ds_cow_create(0, &ca);
+    assert(err != 0);
+
+    err = ds_cow_create(sizeof(int), &ca);
+    assert(err == 0);
+    assert(ca != NULL);
+    assert(ds_cow_len(ca) == 0);
+    ds_cow_free(ca);
+    return 0;
+}
+
+static int modify(void) {
+    struct cow_array *ca;
+    const int n = 5000;
+    int element;
+    int err;
+
+    err = ds_cow_create(sizeof(int), &ca);
+    assert(err == 0);
+
+    for (int i = 0; i < n; i++) {
+        err = ds_cow_append(ca, &i);
+        assert(err == 0);
+        assert(ds_cow_len(ca) == i + 1);
+    }
+
+    /* Reverse across pages */
+    for (int i = 0; i < n / 2; i++) {
+        err = ds_cow_swap(ca, i, n - i - 1);
+        assert(err == 0);
+    }
+
+    for (int i = 0; i < n; i += 2) {
+        element = -i;
+        err = ds_cow_set_value(ca, i, &element);
+        assert(err == 0);
+    }
+
+    for (int i = 0; i < n; i++) {
+        err = ds_cow_get_value(ca, i, &element);
+        assert(err == 0);
+        assert(element == (i % 2 == 0 ? -i : n - i - 1));
+    }
+
+    err = ds_cow_get_value(ca, n, &element);
+    assert(err != 0);
+    err = ds_cow_set_value(ca, n, &element);
+    assert(err != 0);
+    err = ds_cow_swap(ca, 0, n);
+    assert(err != 0);
+
+    for (int i = n - 1; i >= 0; i--) {
+        err = ds_cow_pop(ca, &element);
+        assert(err == 0);
+        assert(element == (i % 2 == 0 ? -i : n - i - 1));
+    }
+    element = 7;
+    err = ds_cow_pop(ca, &element);
+    assert(err != 0);
+    assert(element == 7);
+
+    ds_cow_free(ca);
+    return 0;
+}
+
+static int snapshot(void) {
+    struct cow_snapshot *snaps[3];
+    struct cow_array *ca;
+    const int n = 3000;
+    int element;
+    int err;
+
+    err = ds_cow_create(sizeof(int), &ca);
+    assert(err == 0);
+
+    /* Snapshot i sees n * i elements, each with the value i */
+    for (int s = 0; s < ARRAY_LEN(snaps); s++) {
+        for (int i = 0; i < ds_cow_len(ca); i++) {
+            err = ds_cow_set_value(ca, i, &s);
+            assert(err == 0);
+        }
+        err = ds_cow_snapshot(ca, &snaps[s]);
+        assert(err == 0);
+        assert(ds_cow_snapshot_len(snaps[s]) == ds_cow_len(ca));
+
+        for (int i = 0; i < n; i++) {
+            int value = s + 1;
+
+            err = ds_cow_append(ca, &value);
+            assert(err == 0);
+        }
+    }
+
+    /* Popping and overwriting must not show through */
+    for (int i = 0; i < n; i++) {
+        err = ds_cow_pop(ca, NULL);
+        assert(err == 0);
+    }
+    for (int i = 0; i < n; i++) {
+        element = -1;
+        err = ds_cow_append(ca, &element);
+        assert(err == 0);
+    }
+
+    /* Free out of order, the array and other snapshots are unaffected */
+    ds_cow_snapshot_free(snaps[1]);
+    for (int s = 0; s < ARRAY_LEN(snaps); s += 2) {
+        assert(ds_cow_snapshot_len(snaps[s]) == s * n);
+        for (int i = 0; i < s * n; i++) {
+            err = ds_cow_snapshot_get_value(snaps[s], i, &element);
+            assert(err == 0);
+            assert(element == s);
+        }
+        err = ds_cow_snapshot_get_value(snaps[s], s * n, &element);
+        assert(err != 0);
+    }
+
+    ds_cow_free(ca);
+
+    /* Snapshots outlive the array */
+    err = ds_cow_snapshot_get_value(snaps[2], 2 * n - 1, &element);
+    assert(err == 0);
+    assert(element == 2);
+    ds_cow_snapshot_free(snaps[0]);
+    ds_cow_snapshot_free(snaps[2]);
+    return 0;
+}
+
+static void *check_snapshot(void *arg) {
+    struct cow_snapshot *snap = arg;
+    int element;
+
+    /* Every snapshot is taken with all elements equal to its length */
+    for (size_t i = 0; i < ds_cow_snapshot_len(snap); i++) {
+        ds_cow_snapshot_get_value(snap, i, &element);
+        assert(element == ds_cow_snapshot_len(snap));
+    }
+    ds_cow_snapshot_free(snap);
+    return NULL;
+}
+
+static int concurrent_readers(void) {
+    pthread_t readers[20];
+    struct cow_array *ca;
+    int len;
+    int err;
+
+    err = ds_cow_create(sizeof(int), &ca);
+    assert(err == 0);
+
+    for (int r = 0; r < ARRAY_LEN(readers); r++) {
+        struct cow_snapshot *snap;
+
+        /* Grow, then rewrite every element while older readers run */
+        for (int i = 0; i < 2000; i++) {
+            err = ds_cow_append(ca, &i);
+            assert(err == 0);
+        }
+        len = ds_cow_len(ca);
+        for (int i = 0; i < len; i++) {
+            err = ds_cow_set_value(ca, i, &len);
+            assert(err == 0);
+        }
+
+        err = ds_cow_snapshot(ca, &snap);
+        assert(err == 0);
+        err = pthread_create(&readers[r], NULL, check_snapshot, snap);
+        assert(err == 0);
+    }
+
+    for (int r = 0; r < ARRAY_LEN(readers); r++) {
+        pthread_join(readers[r], NULL);
+    }
+
+    ds_cow_free(ca);
+    return 0;
+}
+
+int main(void) {
+    tap_easy_register(create, "Checks creation");
+    tap_easy_register(modify, "Checks appending, setting, swapping, popping");
+    tap_easy_register(snapshot, "Checks snapshots are isolated from writes");
+    tap_easy_register(concurrent_readers,
+                      "Checks readers run alongside the writer");
+    tap_easy_runall_and_cleanup();
+}
@@ -1,10 +1,37 @@
 #include <assert.h>
 #include <data_structures.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <tap.h>
 
 #define ARRAY_LEN(A) (sizeof(A) / sizeof(*A))
 
+/* Whether the kernel advised huge pages for the mapping holding addr */
+static bool is_huge_advised(void *addr) {
+    FILE *smaps = fopen("/proc/self/smaps", "r");
+    bool inside = false, advised = false;
+    char line[512];
+
+    if (!smaps) {
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), smaps)) {
+        unsigned long start, end;
+
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            inside = start <= (uintptr_t)addr && (uintptr_t)addr < end;
+        } else if (inside && strncmp(line, "VmFlags:", 8) == 0) {
+            advised = strstr(line, " hg ") || strstr(line, " hg\n");
+        }
+    }
+    fclose(smaps);
+    return advised;
+}
+
 static int create(void) {
     struct dynamic_array *da = NULL;
     int err;
@@ -242,11 +269,101 @@ static int pop_value(void) {
     return 0;
 }
 
+static int mem_policy(void) {
+    struct ds_mem_policy policy = {0};
+    struct ds_mem_stats stats;
+    struct dynamic_array *da;
+    const int n = 100000;
+    int element;
+    int err;
+
+    err = ds_da_create(sizeof(int), &da);
+    assert(err == 0);
+
+    ds_da_mem_stats(da, &stats);
+    assert(stats.requested == 0);
+    assert(stats.applied == 0);
+
+    /* NUMA policies are exclusive and need nodes */
+    policy.flags = DS_MEM_NUMA_BIND | DS_MEM_NUMA_INTERLEAVE;
+    policy.nodemask = 1;
+    err = ds_da_set_mem_policy(da, &policy);
+    assert(err == EINVAL);
+    policy.flags = DS_MEM_NUMA_BIND;
+    policy.nodemask = 0;
+    err = ds_da_set_mem_policy(da, &policy);
+    assert(err == EINVAL);
+
+    for (int i = 0; i < 10; i++) {
+        err = ds_da_append(da, &i);
+        assert(err == 0);
+    }
+
+    /* Node 0 always exists, but the system may still refuse any of these */
+    policy.flags = DS_MEM_HUGEPAGE_ALIGN | DS_MEM_HUGEPAGE_ADVISE |
+                   DS_MEM_NUMA_BIND;
+    policy.nodemask = 1;
+    err = ds_da_set_mem_policy(da, &policy);
+    assert(err == 0);
+
+    for (int i = 10; i < n; i++) {
+        err = ds_da_append(da, &i);
+        assert(err == 0);
+
+        ds_da_mem_stats(da, &stats);
+        assert(stats.requested == policy.flags);
+        assert((stats.applied & ~stats.requested) == 0);
+        assert(stats.bytes >= ds_da_len(da) * sizeof(int));
+        if (stats.applied & DS_MEM_HUGEPAGE_ALIGN) {
+            assert((uintptr_t)da->array % (2 << 20) == 0);
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        err = ds_da_get_value(da, i, &element);
+        assert(err == 0);
+        assert(element == i);
+    }
+
+    /* Unaligned mappings grow by moving them */
+    policy.flags = DS_MEM_HUGEPAGE_ADVISE;
+    err = ds_da_set_mem_policy(da, &policy);
+    assert(err == 0);
+    for (int i = n; i < 2 * n; i++) {
+        err = ds_da_append(da, &i);
+        assert(err == 0);
+    }
+    for (int i = 0; i < 2 * n; i++) {
+        err = ds_da_get_value(da, i, &element);
+        assert(err == 0);
+        assert(element == i);
+    }
+    ds_da_mem_stats(da, &stats);
+    if (stats.applied & DS_MEM_HUGEPAGE_ADVISE) {
+        assert(is_huge_advised(da->array));
+    }
+
+    /* Back to the default policy, the advice must not linger */
+    policy.flags = 0;
+    err = ds_da_set_mem_policy(da, &policy);
+    assert(err == 0);
+    ds_da_mem_stats(da, &stats);
+    assert(stats.applied == 0);
+    assert(!is_huge_advised(da->array));
+    err = ds_da_get_value(da, 2 * n - 1, &element);
+    assert(err == 0);
+    assert(element == 2 * n - 1);
+
+    ds_da_free(da);
+    return 0;
+}
+
 int main(void) {
     tap_easy_register(create, "Checks creation");
     tap_easy_register(append, "Checks appending values");
     tap_easy_register(append_ref, "Checks appending pointers");
     tap_easy_register(swap, "Checks swapping indices");
     tap_easy_register(pop_value, "Check popping elements");
+    tap_easy_register(mem_policy, "Checks memory placement policy");
     tap_easy_runall_and_cleanup();
 }
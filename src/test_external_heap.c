@@ -0,0 +1,255 @@
+#include <assert.h>
+#include <data_structures.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <tap.h>
+
+#define ARRAY_LEN(A) (sizeof(A) / sizeof(*A))
+
+static int intcmp(void *v1, void *v2) {
+    int *i1 = v1;
+    int *i2 = v2;
+    return *i1 - *i2;
+}
+
+static int create(void) {
+    struct external_heap *eheap;
+    int element;
+    int err;
+
+    err = ds_eheap_create(sizeof(int), intcmp, 0, NULL, &eheap);
+    assert(err == EINVAL);
+
+    err = ds_eheap_create(sizeof(int), intcmp, 64, NULL, &eheap);
+    assert(err == 0);
+    assert(eheap);
+    assert(ds_eheap_len(eheap) == 0);
+    assert(ds_eheap_nruns(eheap) == 0);
+
+    /* Once the runs cannot be trusted every call fails */
+    element = 1;
+    err = ds_eheap_add(eheap, &element);
+    assert(err == 0);
+    eheap->err = EIO;
+    assert(ds_eheap_add(eheap, &element) == EIO);
+    assert(ds_eheap_get_min(eheap, &element) == EIO);
+    assert(ds_eheap_pop_min(eheap, &element) == EIO);
+    ds_eheap_free(eheap);
+    return 0;
+}
+
+static int spill(void) {
+    struct external_heap *eheap;
+    const int n = 1000;
+    int element;
+    int prev;
+    int err;
+
+    /* Room for 16 elements in memory */
+    err = ds_eheap_create(sizeof(int), intcmp, 16 * sizeof(int), NULL,
+                          &eheap);
+    assert(err == 0);
+
+    err = ds_eheap_pop_min(eheap, &element);
+    assert(err != 0);
+
+    srand(1);
+    for (int i = 0; i < n; i++) {
+        element = rand() % n;
+        err = ds_eheap_add(eheap, &element);
+        assert(err == 0);
+        assert(ds_eheap_len(eheap) == i + 1);
+        assert(ds_eheap_nruns(eheap) == i / 16);
+    }
+
+    prev = -1;
+    for (int i = 0; i < n; i++) {
+        int min;
+
+        err = ds_eheap_get_min(eheap, &min);
+        assert(err == 0);
+        err = ds_eheap_pop_min(eheap, &element);
+        assert(err == 0);
+        assert(element == min);
+        assert(element >= prev);
+        assert(ds_eheap_len(eheap) == n - i - 1);
+        prev = element;
+    }
+    assert(ds_eheap_nruns(eheap) == 0);
+
+    ds_eheap_free(eheap);
+    return 0;
+}
+
+static int interleaved(void) {
+    struct external_heap *eheap;
+    struct heap *check;
+    int element, expected;
+    int err;
+
+    /* Mirror every operation on an in-memory heap */
+    err = ds_eheap_create(sizeof(int), intcmp, 10 * sizeof(int), NULL,
+                          &eheap);
+    assert(err == 0);
+    err = ds_heap_create(sizeof(int), intcmp, &check);
+    assert(err == 0);
+
+    srand(2);
+    for (int i = 0; i < 5000; i++) {
+        if (rand() % 3 != 0 || ds_heap_len(check) == 0) {
+            element = rand() % 500;
+            err = ds_eheap_add(eheap, &element);
+            assert(err == 0);
+            err = ds_heap_add(check, &element);
+            assert(err == 0);
+        } else {
+            err = ds_eheap_pop_min(eheap, &element);
+            assert(err == 0);
+            err = ds_heap_pop_min(check, &expected);
+            assert(err == 0);
+            assert(element == expected);
+        }
+        assert(ds_eheap_len(eheap) == ds_heap_len(check));
+    }
+    assert(ds_eheap_nruns(eheap) > 0);
+
+    while (ds_heap_pop_min(check, &expected) == 0) {
+        err = ds_eheap_pop_min(eheap, &element);
+        assert(err == 0);
+        assert(element == expected);
+    }
+    assert(ds_eheap_len(eheap) == 0);
+
+    ds_heap_free(check);
+    ds_eheap_free(eheap);
+    return 0;
+}
+
+static int bad_dir(void) {
+    struct external_heap *eheap;
+    int element = 1;
+    int err;
+
+    err = ds_eheap_create(sizeof(int), intcmp, sizeof(int),
+                          "/nonexistent/ds_spill", &eheap);
+    assert(err == 0);
+
+    err = ds_eheap_add(eheap, &element);
+    assert(err == 0);
+
+    /* Spilling fails, but nothing is lost */
+    err = ds_eheap_add(eheap, &element);
+    assert(err != 0);
+    assert(ds_eheap_len(eheap) == 1);
+
+    err = ds_eheap_pop_min(eheap, &element);
+    assert(err == 0);
+    assert(element == 1);
+
+    ds_eheap_free(eheap);
+    return 0;
+}
+
+static int many_runs(void) {
+    struct external_heap *eheap;
+    const int n = 5000;
+    int element;
+    int prev;
+    int err;
+
+    /* Every add spills, runs must be merged to stay open */
+    err = ds_eheap_create(sizeof(int), intcmp, sizeof(int), NULL, &eheap);
+    assert(err == 0);
+
+    srand(3);
+    for (int i = 0; i < n; i++) {
+        element = rand() % n;
+        err = ds_eheap_add(eheap, &element);
+        assert(err == 0);
+        assert(ds_eheap_nruns(eheap) <= 64);
+    }
+
+    prev = -1;
+    for (int i = 0; i < n; i++) {
+        err = ds_eheap_pop_min(eheap, &element);
+        assert(err == 0);
+        assert(element >= prev);
+        prev = element;
+    }
+    assert(ds_eheap_len(eheap) == 0);
+
+    ds_eheap_free(eheap);
+    return 0;
+}
+
+/* Add until a write fails, then check every element can still be popped */
+static void fill_until_full(struct external_heap *eheap, size_t max_bytes) {
+    struct rlimit limit, full;
+    int element, prev;
+    size_t len;
+    int err;
+
+    /* Past RLIMIT_FSIZE writes fail with EFBIG, like a full disk */
+    signal(SIGXFSZ, SIG_IGN);
+    err = getrlimit(RLIMIT_FSIZE, &limit);
+    assert(err == 0);
+    full = limit;
+    full.rlim_cur = max_bytes;
+    err = setrlimit(RLIMIT_FSIZE, &full);
+    assert(err == 0);
+
+    srand(4);
+    do {
+        element = rand() % 1000;
+        len = ds_eheap_len(eheap);
+        err = ds_eheap_add(eheap, &element);
+    } while (err == 0);
+    assert(err == EFBIG);
+    assert(ds_eheap_len(eheap) == len);
+
+    err = setrlimit(RLIMIT_FSIZE, &limit);
+    assert(err == 0);
+    signal(SIGXFSZ, SIG_DFL);
+
+    prev = -1;
+    for (size_t i = 0; i < len; i++) {
+        err = ds_eheap_pop_min(eheap, &element);
+        assert(err == 0);
+        assert(element >= prev);
+        prev = element;
+    }
+    assert(ds_eheap_len(eheap) == 0);
+}
+
+static int full_disk(void) {
+    struct external_heap *eheap;
+    int err;
+
+    /* The first run does not fit */
+    err = ds_eheap_create(sizeof(int), intcmp, 1024 * sizeof(int), NULL,
+                          &eheap);
+    assert(err == 0);
+    fill_until_full(eheap, 1024);
+    ds_eheap_free(eheap);
+
+    /* Runs fit, but merging them does not */
+    err = ds_eheap_create(sizeof(int), intcmp, 16 * sizeof(int), NULL,
+                          &eheap);
+    assert(err == 0);
+    fill_until_full(eheap, 512);
+    assert(ds_eheap_nruns(eheap) == 0);
+    ds_eheap_free(eheap);
+    return 0;
+}
+
+int main(void) {
+    tap_easy_register(create, "Checks creation");
+    tap_easy_register(spill, "Checks spilling runs and popping in order");
+    tap_easy_register(interleaved, "Checks interleaved adds and pops");
+    tap_easy_register(bad_dir, "Checks failing to spill");
+    tap_easy_register(many_runs, "Checks runs are merged");
+    tap_easy_register(full_disk, "Checks a full disk loses nothing");
+    tap_easy_runall_and_cleanup();
+}
@@ -0,0 +1,275 @@
+#include <assert.h>
+#include <data_structures.h>
+#include <errno.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tap.h>
+
+#define ARRAY_LEN(A) (sizeof(A) / sizeof(*A))
+
+static uint64_t inthash(void *v) {
+    uint64_t h = *(int *)v;
+
+    /* splitmix64 finaliser */
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+/* Sends every key to the same group to exercise probing */
+static uint64_t badhash(void *v) { return *(int *)v & 0x7f; }
+
+static int inteq(void *v1, void *v2) { return *(int *)v1 != *(int *)v2; }
+
+/* Reads the key as a uint64_t, so stored keys must be aligned */
+static uint64_t u64hash(void *v) {
+    assert((uintptr_t)v % alignof(uint64_t) == 0);
+    return *(uint64_t *)v * 0x9e3779b97f4a7c15ULL;
+}
+
+static int u64eq(void *v1, void *v2) {
+    assert((uintptr_t)v2 % alignof(uint64_t) == 0);
+    return *(uint64_t *)v1 != *(uint64_t *)v2;
+}
+
+static int create(void) {
+    struct hash_map *hm;
+    int err;
+
+    err = ds_hm_create(sizeof(int), sizeof(int), inthash, inteq, &hm);
+    assert(err == 0);
+    assert(hm);
+    assert(ds_hm_len(hm) == 0);
+    ds_hm_free(hm);
+    return 0;
+}
+
+static int insert(void) {
+    struct hash_map *hm;
+    const int n = 1000;
+    int value;
+    int err;
+
+    err = ds_hm_create(sizeof(int), sizeof(int), inthash, inteq, &hm);
+    assert(err == 0);
+
+    for (int i = 0; i < n; i++) {
+        value = i * 3;
+        err = ds_hm_insert(hm, &i, &value);
+        assert(err == 0);
+        assert(ds_hm_len(hm) == i + 1);
+    }
+
+    for (int i = 0; i < n; i++) {
+        value = -1;
+        err = ds_hm_get(hm, &i, &value);
+        assert(err == 0);
+        assert(value == i * 3);
+    }
+
+    /* Replace existing values */
+    for (int i = 0; i < n; i += 2) {
+        value = -i;
+        err = ds_hm_insert(hm, &i, &value);
+        assert(err == 0);
+    }
+    assert(ds_hm_len(hm) == n);
+
+    for (int i = 0; i < n; i++) {
+        err = ds_hm_get(hm, &i, &value);
+        assert(err == 0);
+        assert(value == (i % 2 == 0 ? -i : i * 3));
+    }
+
+    value = n;
+    err = ds_hm_get(hm, &value, NULL);
+    assert(err == ENOENT);
+
+    ds_hm_free(hm);
+    return 0;
+}
+
+static int erase(void) {
+    struct hash_map *hm;
+    const int n = 500;
+    int err;
+
+    err = ds_hm_create(sizeof(int), sizeof(int), badhash, inteq, &hm);
+    assert(err == 0);
+
+    /* Churn through many tombstones without growing */
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < n; i++) {
+            int key = round * n + i;
+
+            err = ds_hm_insert(hm, &key, &i);
+            assert(err == 0);
+        }
+
+        for (int i = 0; i < n; i++) {
+            int key = round * n + i;
+            int value;
+
+            if (i % 3 == 0) {
+                continue;
+            }
+            err = ds_hm_erase(hm, &key);
+            assert(err == 0);
+            err = ds_hm_erase(hm, &key);
+            assert(err == ENOENT);
+            err = ds_hm_get(hm, &key, &value);
+            assert(err == ENOENT);
+        }
+    }
+
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < n; i++) {
+            int key = round * n + i;
+            int value;
+
+            err = ds_hm_get(hm, &key, &value);
+            if (i % 3 == 0) {
+                assert(err == 0);
+                assert(value == i);
+            } else {
+                assert(err == ENOENT);
+            }
+        }
+    }
+    assert(ds_hm_len(hm) == 20 * ((n + 2) / 3));
+
+    ds_hm_free(hm);
+    return 0;
+}
+
+static int bulk_and_iterate(void) {
+    int keys[4096], values[4096];
+    struct hash_map *hm;
+    size_t capacity;
+    size_t iter;
+    char *seen;
+    int key, value;
+    int err;
+
+    err = ds_hm_create(sizeof(int), sizeof(int), inthash, inteq, &hm);
+    assert(err == 0);
+
+    err = ds_hm_reserve(hm, ARRAY_LEN(keys));
+    assert(err == 0);
+    capacity = hm->capacity;
+
+    for (int i = 0; i < ARRAY_LEN(keys); i++) {
+        keys[i] = i * 7;
+        values[i] = i;
+    }
+    err = ds_hm_insert_bulk(hm, keys, values, ARRAY_LEN(keys));
+    assert(err == 0);
+    assert(ds_hm_len(hm) == ARRAY_LEN(keys));
+    /* Reserved space should be enough */
+    assert(hm->capacity == capacity);
+
+    seen = calloc(ARRAY_LEN(keys), 1);
+    assert(seen);
+    iter = 0;
+    while (ds_hm_next(hm, &iter, &key, &value) == 0) {
+        assert(key == value * 7);
+        assert(!seen[value]);
+        seen[value] = 1;
+    }
+    for (int i = 0; i < ARRAY_LEN(keys); i++) {
+        assert(seen[i]);
+    }
+    free(seen);
+
+    ds_hm_free(hm);
+    return 0;
+}
+
+static int max_load(void) {
+    struct hash_map *hm;
+    int err;
+
+    err = ds_hm_create(sizeof(int), 0, inthash, inteq, &hm);
+    assert(err == 0);
+
+    err = ds_hm_set_max_load(hm, 0.0f);
+    assert(err == EINVAL);
+    err = ds_hm_set_max_load(hm, 1.0f);
+    assert(err == EINVAL);
+
+    for (int i = 0; i < 100; i++) {
+        err = ds_hm_insert(hm, &i, NULL);
+        assert(err == 0);
+        assert(ds_hm_len(hm) <= hm->capacity * hm->max_load);
+    }
+
+    /* Shrinking the load factor grows the table */
+    err = ds_hm_set_max_load(hm, 0.25f);
+    assert(err == 0);
+    assert(ds_hm_len(hm) <= hm->capacity * 0.25f);
+
+    for (int i = 0; i < 100; i++) {
+        err = ds_hm_get(hm, &i, NULL);
+        assert(err == 0);
+    }
+
+    for (int i = 100; i < 1000; i++) {
+        err = ds_hm_insert(hm, &i, NULL);
+        assert(err == 0);
+        assert(ds_hm_len(hm) <= hm->capacity * 0.25f);
+    }
+
+    /* A table this size cannot be allocated, nothing is changed */
+    err = ds_hm_set_max_load(hm, 1e-30f);
+    assert(err == ENOMEM);
+    assert(hm->max_load == 0.25f);
+    err = ds_hm_reserve(hm, SIZE_MAX);
+    assert(err == ENOMEM);
+    for (int i = 0; i < 1000; i++) {
+        err = ds_hm_get(hm, &i, NULL);
+        assert(err == 0);
+    }
+
+    ds_hm_free(hm);
+    return 0;
+}
+
+static int alignment(void) {
+    struct hash_map *hm;
+    uint32_t value;
+    uint64_t key;
+    size_t iter;
+    int err;
+
+    /* Packed back to back the keys would be misaligned */
+    err = ds_hm_create(sizeof(uint64_t), sizeof(uint32_t), u64hash, u64eq,
+                       &hm);
+    assert(err == 0);
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        key = (uint64_t)i << 32 | i;
+        err = ds_hm_insert(hm, &key, &i);
+        assert(err == 0);
+    }
+
+    iter = 0;
+    while (ds_hm_next(hm, &iter, &key, &value) == 0) {
+        assert(key == ((uint64_t)value << 32 | value));
+    }
+    assert(ds_hm_len(hm) == 1000);
+
+    ds_hm_free(hm);
+    return 0;
+}
+
+int main(void) {
+    tap_easy_register(create, "Checks creation");
+    tap_easy_register(insert, "Checks inserting and replacing values");
+    tap_easy_register(erase, "Checks erasing keys");
+    tap_easy_register(bulk_and_iterate, "Checks bulk insert and iteration");
+    tap_easy_register(max_load, "Checks load factor tuning");
+    tap_easy_register(alignment, "Checks stored keys are aligned");
+    tap_easy_runall_and_cleanup();
+}
@@ -108,9 +108,188 @@ static int pop(void) {
     return 0;
 }
 
+static int pop_random(void) {
+    struct heap *heap;
+    const int n = 1000;
+    int element;
+    int prev;
+    int err;
+
+    err = ds_heap_create(sizeof(int), intcmp, &heap);
+    assert(err == 0);
+
+    srand(1);
+    for (int i = 0; i < n; i++) {
+        element = rand() % n;
+        err = ds_heap_add(heap, &element);
+        assert(err == 0);
+    }
+
+    prev = -1;
+    for (int i = 0; i < n; i++) {
+        err = ds_heap_pop_min(heap, &element);
+        assert(err == 0);
+        assert(element >= prev);
+        prev = element;
+    }
+    assert(ds_heap_len(heap) == 0);
+
+    ds_heap_free(heap);
+    return 0;
+}
+
+static int mem_policy(void) {
+    struct ds_mem_policy policy = {.flags = DS_MEM_HUGEPAGE_ADVISE};
+    struct ds_mem_stats stats;
+    struct heap *heap;
+    int element;
+    int err;
+
+    err = ds_heap_create(sizeof(int), intcmp, &heap);
+    assert(err == 0);
+
+    err = ds_heap_set_mem_policy(heap, &policy);
+    assert(err == 0);
+
+    for (int i = 10000; i > 0; i--) {
+        err = ds_heap_add(heap, &i);
+        assert(err == 0);
+    }
+
+    /* Growth keeps the policy */
+    ds_heap_mem_stats(heap, &stats);
+    assert(stats.requested == DS_MEM_HUGEPAGE_ADVISE);
+    assert((stats.applied & ~stats.requested) == 0);
+    assert(stats.bytes >= 10000 * sizeof(int));
+
+    for (int i = 1; i <= 10000; i++) {
+        err = ds_heap_pop_min(heap, &element);
+        assert(err == 0);
+        assert(element == i);
+    }
+
+    ds_heap_free(heap);
+    return 0;
+}
+
+struct keyed {
+    int key;
+    int seq;
+};
+
+/* Orders by key only, so seq shows which of the equal keys came out */
+static int keycmp(void *v1, void *v2) {
+    struct keyed *k1 = v1;
+    struct keyed *k2 = v2;
+    return k1->key - k2->key;
+}
+
+static int insert_buffer(void) {
+    size_t buffer_maxes[] = {1, 7, 1000};
+
+    /* Check every operation against an unbuffered heap, ties included */
+    for (int i = 0; i < ARRAY_LEN(buffer_maxes); i++) {
+        struct keyed element, expected;
+        struct heap *buffered, *check;
+        int err;
+
+        err = ds_heap_create(sizeof(element), keycmp, &buffered);
+        assert(err == 0);
+        err = ds_heap_create(sizeof(element), keycmp, &check);
+        assert(err == 0);
+        ds_heap_set_insert_buffer(buffered, buffer_maxes[i], false);
+
+        srand(i);
+        for (int op = 0; op < 20000; op++) {
+            if (rand() % 20 != 0) {
+                element.key = rand() % 10;
+                element.seq = op;
+                err = ds_heap_add(buffered, &element);
+                assert(err == 0);
+                err = ds_heap_add(check, &element);
+                assert(err == 0);
+            } else if (rand() % 2) {
+                err = ds_heap_get_min(buffered, &element);
+                assert(err == ds_heap_get_min(check, &expected));
+                assert(err != 0 || memcmp(&element, &expected,
+                                          sizeof(element)) == 0);
+            } else {
+                err = ds_heap_pop_min(buffered, &element);
+                assert(err == ds_heap_pop_min(check, &expected));
+                assert(err != 0 || memcmp(&element, &expected,
+                                          sizeof(element)) == 0);
+            }
+            assert(ds_heap_len(buffered) == ds_heap_len(check));
+        }
+
+        /* Turning the buffer off merges what is pending */
+        ds_heap_set_insert_buffer(buffered, 0, false);
+        assert(buffered->heapified == ds_heap_len(buffered));
+
+        while (ds_heap_pop_min(check, &expected) == 0) {
+            err = ds_heap_pop_min(buffered, &element);
+            assert(err == 0);
+            assert(memcmp(&element, &expected, sizeof(element)) == 0);
+        }
+        err = ds_heap_pop_min(buffered, &element);
+        assert(err != 0);
+
+        ds_heap_free(buffered);
+        ds_heap_free(check);
+    }
+    return 0;
+}
+
+static int insert_buffer_rebuild(void) {
+    int element, expected;
+    struct heap *buffered, *check;
+    int err;
+
+    err = ds_heap_create(sizeof(int), intcmp, &buffered);
+    assert(err == 0);
+    err = ds_heap_create(sizeof(int), intcmp, &check);
+    assert(err == 0);
+    ds_heap_set_insert_buffer(buffered, 5000, true);
+
+    /* Rebuilding may reorder equal keys, the keys still come out sorted */
+    srand(3);
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 3000; i++) {
+            element = i % 2 ? rand() % 1000 : -(round * 3000 + i);
+            err = ds_heap_add(buffered, &element);
+            assert(err == 0);
+            err = ds_heap_add(check, &element);
+            assert(err == 0);
+        }
+        for (int i = 0; i < 1000; i++) {
+            err = ds_heap_pop_min(buffered, &element);
+            assert(err == 0);
+            err = ds_heap_pop_min(check, &expected);
+            assert(err == 0);
+            assert(element == expected);
+        }
+    }
+
+    while (ds_heap_pop_min(check, &expected) == 0) {
+        err = ds_heap_pop_min(buffered, &element);
+        assert(err == 0);
+        assert(element == expected);
+    }
+    assert(ds_heap_len(buffered) == 0);
+
+    ds_heap_free(buffered);
+    ds_heap_free(check);
+    return 0;
+}
+
 int main(void) {
     tap_easy_register(create, "Checks creation");
     tap_easy_register(add, "Checks adding values");
     tap_easy_register(pop, "Checks popping min");
+    tap_easy_register(pop_random, "Checks popping random values in order");
+    tap_easy_register(mem_policy, "Checks memory placement policy");
+    tap_easy_register(insert_buffer, "Checks buffered inserts");
+    tap_easy_register(insert_buffer_rebuild,
+                      "Checks buffered inserts that rebuild the heap");
     tap_easy_runall_and_cleanup();
 }
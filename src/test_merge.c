@@ -0,0 +1,184 @@
+#include <assert.h>
+#include <data_structures.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <tap.h>
+
+#define ARRAY_LEN(A) (sizeof(A) / sizeof(*A))
+
+struct tagged {
+    int value;
+    int run;
+};
+
+static int intcmp(void *v1, void *v2) {
+    int *i1 = v1;
+    int *i2 = v2;
+    return *i1 - *i2;
+}
+
+/* Only compares values, so the run tag shows the order of ties */
+static int taggedcmp(void *v1, void *v2) {
+    struct tagged *t1 = v1;
+    struct tagged *t2 = v2;
+    return t1->value - t2->value;
+}
+
+static int qsort_intcmp(const void *v1, const void *v2) {
+    return intcmp((void *)v1, (void *)v2);
+}
+
+static void create_runs(struct dynamic_array **runs, size_t k, int len) {
+    for (size_t i = 0; i < k; i++) {
+        int value = 0;
+        int err;
+
+        err = ds_da_create(sizeof(int), &runs[i]);
+        assert(err == 0);
+
+        /* Vary the run lengths, including empty runs */
+        for (int j = 0; j < (len * (i + 1)) % (len + 1); j++) {
+            value += rand() % 5;
+            err = ds_da_append(runs[i], &value);
+            assert(err == 0);
+        }
+    }
+}
+
+static void free_runs(struct dynamic_array **runs, size_t k) {
+    for (size_t i = 0; i < k; i++) {
+        ds_da_free(runs[i]);
+    }
+}
+
+static int create(void) {
+    struct dynamic_array *runs[2];
+    struct merge *merge;
+    int err;
+
+    err = ds_da_create(sizeof(int), &runs[0]);
+    assert(err == 0);
+    err = ds_da_create(sizeof(char), &runs[1]);
+    assert(err == 0);
+
+    err = ds_merge_create(runs, 0, intcmp, &merge);
+    assert(err == EINVAL);
+
+    /* Runs must share an element size */
+    err = ds_merge_create(runs, 2, intcmp, &merge);
+    assert(err == EINVAL);
+
+    err = ds_merge_create(runs, 1, intcmp, &merge);
+    assert(err == 0);
+    assert(merge);
+    assert(ds_merge_len(merge) == 0);
+    ds_merge_free(merge);
+
+    free_runs(runs, ARRAY_LEN(runs));
+    return 0;
+}
+
+static int merge_runs(void) {
+    size_t ks[] = {1, 2, 3, 7, 16, 33};
+    size_t batches[] = {1, 5, 64};
+
+    srand(1);
+    for (int i = 0; i < ARRAY_LEN(ks); i++) {
+        for (int j = 0; j < ARRAY_LEN(batches); j++) {
+            struct dynamic_array *runs[33];
+            struct merge *merge;
+            size_t total, seen;
+            int *expected;
+            int out[64];
+            int err;
+
+            create_runs(runs, ks[i], 50);
+            total = 0;
+            for (size_t r = 0; r < ks[i]; r++) {
+                total += ds_da_len(runs[r]);
+            }
+
+            /* The merge must match all runs concatenated and sorted */
+            expected = malloc((total + 1) * sizeof(*expected));
+            assert(expected);
+            seen = 0;
+            for (size_t r = 0; r < ks[i]; r++) {
+                for (size_t e = 0; e < ds_da_len(runs[r]); e++) {
+                    err = ds_da_get_value(runs[r], e, &expected[seen++]);
+                    assert(err == 0);
+                }
+            }
+            qsort(expected, total, sizeof(*expected), qsort_intcmp);
+
+            err = ds_merge_create(runs, ks[i], intcmp, &merge);
+            assert(err == 0);
+            assert(ds_merge_len(merge) == total);
+
+            seen = 0;
+            for (;;) {
+                size_t written;
+
+                err = ds_merge_next_n(merge, out, batches[j], &written);
+                assert(err == 0);
+                assert(written <= batches[j]);
+                if (written == 0) {
+                    break;
+                }
+
+                for (size_t w = 0; w < written; w++) {
+                    assert(out[w] == expected[seen + w]);
+                }
+                seen += written;
+                assert(ds_merge_len(merge) == total - seen);
+            }
+            assert(seen == total);
+
+            free(expected);
+            ds_merge_free(merge);
+            free_runs(runs, ks[i]);
+        }
+    }
+    return 0;
+}
+
+static int stable(void) {
+    struct dynamic_array *runs[5];
+    struct tagged out[40];
+    struct merge *merge;
+    size_t written;
+    int err;
+
+    /* Every run holds 0..7 */
+    for (int r = 0; r < ARRAY_LEN(runs); r++) {
+        err = ds_da_create(sizeof(struct tagged), &runs[r]);
+        assert(err == 0);
+        for (int v = 0; v < 8; v++) {
+            struct tagged t = {.value = v, .run = r};
+
+            err = ds_da_append(runs[r], &t);
+            assert(err == 0);
+        }
+    }
+
+    err = ds_merge_create(runs, ARRAY_LEN(runs), taggedcmp, &merge);
+    assert(err == 0);
+    err = ds_merge_next_n(merge, out, ARRAY_LEN(out), &written);
+    assert(err == 0);
+    assert(written == ARRAY_LEN(out));
+
+    for (int i = 0; i < ARRAY_LEN(out); i++) {
+        assert(out[i].value == i / ARRAY_LEN(runs));
+        assert(out[i].run == i % ARRAY_LEN(runs));
+    }
+
+    ds_merge_free(merge);
+    free_runs(runs, ARRAY_LEN(runs));
+    return 0;
+}
+
+int main(void) {
+    tap_easy_register(create, "Checks creation");
+    tap_easy_register(merge_runs, "Checks merging runs in batches");
+    tap_easy_register(stable, "Checks ties keep run order");
+    tap_easy_runall_and_cleanup();
+}
@@ -0,0 +1,209 @@
+#include <assert.h>
+#include <data_structures.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <tap.h>
+
+#define ARRAY_LEN(A) (sizeof(A) / sizeof(*A))
+
+static int intcmp(void *v1, void *v2) {
+    int *i1 = v1;
+    int *i2 = v2;
+    return *i1 - *i2;
+}
+
+/* A valid strcmp-like result that cannot be negated */
+static int extremecmp(void *v1, void *v2) {
+    int *i1 = v1;
+    int *i2 = v2;
+    return *i1 < *i2 ? INT_MIN : *i1 > *i2 ? INT_MAX : 0;
+}
+
+/* Index of the smallest (dir 1) or largest (dir -1) element */
+static int find(const int *elements, int len, int dir) {
+    int best = 0;
+
+    for (int i = 1; i < len; i++) {
+        if (dir * (elements[i] - elements[best]) < 0) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+static int create(void) {
+    struct mmheap *heap;
+    int element;
+    int err;
+
+    err = ds_mmheap_create(sizeof(int), intcmp, &heap);
+    assert(err == 0);
+    assert(heap);
+    assert(ds_mmheap_len(heap) == 0);
+
+    err = ds_mmheap_get_min(heap, &element);
+    assert(err != 0);
+    err = ds_mmheap_get_max(heap, &element);
+    assert(err != 0);
+    err = ds_mmheap_pop_min(heap, &element);
+    assert(err != 0);
+    err = ds_mmheap_pop_max(heap, &element);
+    assert(err != 0);
+
+    ds_mmheap_free(heap);
+    return 0;
+}
+
+static int pop_both_ends(void) {
+    int elements[] = {9, 7, 8, 4, 5, 6, 3, 1, 2, 0};
+    struct mmheap *heap;
+    int element;
+    int err;
+
+    err = ds_mmheap_create(sizeof(int), intcmp, &heap);
+    assert(err == 0);
+
+    for (int i = 0; i < ARRAY_LEN(elements); i++) {
+        err = ds_mmheap_add(heap, &elements[i]);
+        assert(err == 0);
+    }
+
+    /* Alternate ends, meeting in the middle */
+    for (int i = 0; i < ARRAY_LEN(elements) / 2; i++) {
+        err = ds_mmheap_pop_min(heap, &element);
+        assert(err == 0);
+        assert(element == i);
+
+        err = ds_mmheap_pop_max(heap, &element);
+        assert(err == 0);
+        assert(element == 9 - i);
+    }
+    assert(ds_mmheap_len(heap) == 0);
+
+    ds_mmheap_free(heap);
+    return 0;
+}
+
+static void check_random_ops(ds_cmp cmp) {
+    struct mmheap *heap;
+    int check[2000];
+    int len = 0;
+    int element;
+    int err;
+
+    /* Mirror every operation on an unordered array */
+    err = ds_mmheap_create(sizeof(int), cmp, &heap);
+    assert(err == 0);
+
+    srand(1);
+    for (int op = 0; op < 20000; op++) {
+        int action = rand() % 4;
+
+        if (len == 0 || (action < 2 && len < ARRAY_LEN(check))) {
+            element = rand() % 500;
+            err = ds_mmheap_add(heap, &element);
+            assert(err == 0);
+            check[len++] = element;
+        } else {
+            int dir = action == 2 ? 1 : -1;
+            int idx = find(check, len, dir);
+
+            if (dir == 1) {
+                err = ds_mmheap_pop_min(heap, &element);
+            } else {
+                err = ds_mmheap_pop_max(heap, &element);
+            }
+            assert(err == 0);
+            assert(element == check[idx]);
+            check[idx] = check[--len];
+        }
+        assert(ds_mmheap_len(heap) == len);
+
+        if (len > 0) {
+            err = ds_mmheap_get_min(heap, &element);
+            assert(err == 0);
+            assert(element == check[find(check, len, 1)]);
+            err = ds_mmheap_get_max(heap, &element);
+            assert(err == 0);
+            assert(element == check[find(check, len, -1)]);
+        }
+    }
+
+    ds_mmheap_free(heap);
+}
+
+static int random_ops(void) {
+    check_random_ops(intcmp);
+    check_random_ops(extremecmp);
+    return 0;
+}
+
+static int bounded(void) {
+    const size_t k = 10;
+    int counts[1000] = {0};
+    struct mmheap *heap;
+    int element, evicted;
+    bool was_evicted;
+    int err;
+
+    err = ds_mmheap_create(sizeof(int), intcmp, &heap);
+    assert(err == 0);
+
+    err = ds_mmheap_push_bounded(heap, &element, 0, NULL, &was_evicted);
+    assert(err != 0);
+
+    srand(2);
+    for (int i = 0; i < 10000; i++) {
+        element = rand() % ARRAY_LEN(counts);
+        counts[element]++;
+
+        err = ds_mmheap_push_bounded(heap, &element, k, &evicted,
+                                     &was_evicted);
+        assert(err == 0);
+        assert(ds_mmheap_len(heap) == (i < k ? i + 1 : k));
+        assert(was_evicted == (i >= k));
+        if (was_evicted) {
+            int max;
+
+            /* Nothing kept is worse than what was evicted */
+            err = ds_mmheap_get_max(heap, &max);
+            assert(err == 0);
+            assert(max <= evicted);
+        }
+    }
+
+    /* Lowering the bound drops the largest */
+    element = ARRAY_LEN(counts);
+    err = ds_mmheap_push_bounded(heap, &element, k / 2, &evicted,
+                                 &was_evicted);
+    assert(err == 0);
+    assert(was_evicted);
+    assert(evicted == element);
+    assert(ds_mmheap_len(heap) == k / 2);
+
+    /* The heap holds the k / 2 smallest elements offered */
+    element = 0;
+    for (size_t i = 0; i < k / 2; i++) {
+        int popped;
+
+        while (counts[element] == 0) {
+            element++;
+        }
+        counts[element]--;
+
+        err = ds_mmheap_pop_min(heap, &popped);
+        assert(err == 0);
+        assert(popped == element);
+    }
+
+    ds_mmheap_free(heap);
+    return 0;
+}
+
+int main(void) {
+    tap_easy_register(create, "Checks creation");
+    tap_easy_register(pop_both_ends, "Checks popping min and max");
+    tap_easy_register(random_ops, "Checks random adds and pops");
+    tap_easy_register(bounded, "Checks bounded push evicts the max");
+    tap_easy_runall_and_cleanup();
+}
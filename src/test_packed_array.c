@@ -0,0 +1,186 @@
+#include <assert.h>
+#include <data_structures.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <tap.h>
+
+#define ARRAY_LEN(A) (sizeof(A) / sizeof(*A))
+
+static int create(void) {
+    struct packed_array *pa = NULL;
+    int err;
+
+    err = ds_pa_create(0, &pa);
+    assert(err == EINVAL);
+    err = ds_pa_create(17, &pa);
+    assert(err == EINVAL);
+
+    err = ds_pa_create(1, &pa);
+    assert(err == 0);
+    assert(pa != NULL);
+    assert(ds_pa_len(pa) == 0);
+    ds_pa_free(pa);
+    return 0;
+}
+
+static int widths(void) {
+    const int n = 1000;
+
+    /* Odd widths straddle word boundaries */
+    for (unsigned int width = 1; width <= 16; width++) {
+        uint16_t max = (1u << width) - 1;
+        struct packed_array *pa;
+        uint16_t value;
+        int err;
+
+        err = ds_pa_create(width, &pa);
+        assert(err == 0);
+
+        if (width < 16) {
+            err = ds_pa_append(pa, max + 1);
+            assert(err == EINVAL);
+        }
+
+        for (int i = 0; i < n; i++) {
+            err = ds_pa_append(pa, (i * 7) & max);
+            assert(err == 0);
+            assert(ds_pa_len(pa) == i + 1);
+        }
+
+        for (int i = 0; i < n; i += 3) {
+            err = ds_pa_set_value(pa, i, max - (i & max));
+            assert(err == 0);
+        }
+
+        for (int i = 0; i < n; i++) {
+            err = ds_pa_get_value(pa, i, &value);
+            assert(err == 0);
+            assert(value == (i % 3 == 0 ? max - (i & max) : (i * 7) & max));
+        }
+
+        err = ds_pa_get_value(pa, n, &value);
+        assert(err == EINVAL);
+        err = ds_pa_set_value(pa, n, 0);
+        assert(err == EINVAL);
+
+        for (int i = n - 1; i >= 0; i--) {
+            err = ds_pa_pop(pa, &value);
+            assert(err == 0);
+            assert(value == (i % 3 == 0 ? max - (i & max) : (i * 7) & max));
+        }
+        err = ds_pa_pop(pa, &value);
+        assert(err == EINVAL);
+        assert(ds_pa_popcount(pa) == 0);
+
+        ds_pa_free(pa);
+    }
+    return 0;
+}
+
+static int bit_queries(void) {
+    struct packed_array *pa;
+    const int n = 1000;
+    size_t count, rank, idx;
+    char bits[1000];
+    int err;
+
+    err = ds_pa_create(1, &pa);
+    assert(err == 0);
+
+    err = ds_pa_find_first_set(pa, 0, &idx);
+    assert(err == ENOENT);
+
+    srand(1);
+    count = 0;
+    for (int i = 0; i < n; i++) {
+        bits[i] = rand() % 5 == 0;
+        count += bits[i];
+        err = ds_pa_append(pa, bits[i]);
+        assert(err == 0);
+    }
+    assert(ds_pa_popcount(pa) == count);
+
+    rank = 0;
+    for (int i = 0; i <= n; i++) {
+        size_t check;
+
+        err = ds_pa_rank(pa, i, &check);
+        assert(err == 0);
+        assert(check == rank);
+
+        if (i < n && bits[i]) {
+            err = ds_pa_select(pa, rank, &idx);
+            assert(err == 0);
+            assert(idx == i);
+            rank++;
+        }
+    }
+    err = ds_pa_select(pa, count, &idx);
+    assert(err == ENOENT);
+    err = ds_pa_rank(pa, n + 1, &rank);
+    assert(err == EINVAL);
+
+    for (int i = 0; i < n; i++) {
+        int next = i;
+
+        while (next < n && !bits[next]) {
+            next++;
+        }
+
+        err = ds_pa_find_first_set(pa, i, &idx);
+        if (next == n) {
+            assert(err == ENOENT);
+        } else {
+            assert(err == 0);
+            assert(idx == next);
+        }
+    }
+
+    ds_pa_free(pa);
+    return 0;
+}
+
+static int packed_queries(void) {
+    uint16_t values[] = {0, 0, 0, 0, 5, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 6};
+    struct packed_array *pa;
+    size_t idx;
+    int err;
+
+    err = ds_pa_create(3, &pa);
+    assert(err == 0);
+
+    for (int i = 0; i < ARRAY_LEN(values); i++) {
+        err = ds_pa_append(pa, values[i]);
+        assert(err == 0);
+    }
+
+    /* 5 + 1 + 6 is five set bits */
+    assert(ds_pa_popcount(pa) == 5);
+
+    err = ds_pa_find_first_set(pa, 0, &idx);
+    assert(err == 0);
+    assert(idx == 4);
+    err = ds_pa_find_first_set(pa, 5, &idx);
+    assert(err == 0);
+    assert(idx == 14);
+    err = ds_pa_find_first_set(pa, 15, &idx);
+    assert(err == 0);
+    assert(idx == 16);
+
+    /* Rank and select only apply to bit arrays */
+    err = ds_pa_rank(pa, 1, &idx);
+    assert(err == EINVAL);
+    err = ds_pa_select(pa, 1, &idx);
+    assert(err == EINVAL);
+
+    ds_pa_free(pa);
+    return 0;
+}
+
+int main(void) {
+    tap_easy_register(create, "Checks creation");
+    tap_easy_register(widths, "Checks append, get, set and pop at each width");
+    tap_easy_register(bit_queries, "Checks popcount, rank and select");
+    tap_easy_register(packed_queries, "Checks queries on packed integers");
+    tap_easy_runall_and_cleanup();
+}
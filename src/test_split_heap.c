@@ -0,0 +1,159 @@
+#include <assert.h>
+#include <data_structures.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tap.h>
+
+#define ARRAY_LEN(A) (sizeof(A) / sizeof(*A))
+
+struct job {
+    uint64_t deadline;
+    char descriptor[184];
+};
+
+static int u64cmp(void *v1, void *v2) {
+    uint64_t *i1 = v1;
+    uint64_t *i2 = v2;
+    return (*i1 > *i2) - (*i1 < *i2);
+}
+
+static void make_job(struct job *job, uint64_t deadline) {
+    job->deadline = deadline;
+    memset(job->descriptor, (char)deadline, sizeof(job->descriptor));
+}
+
+static void check_job(const struct job *job, uint64_t deadline) {
+    assert(job->deadline == deadline);
+    for (int i = 0; i < sizeof(job->descriptor); i++) {
+        assert(job->descriptor[i] == (char)deadline);
+    }
+}
+
+static int create(void) {
+    struct split_heap *heap;
+    int err;
+
+    err = ds_sheap_create(sizeof(uint64_t), sizeof(struct job), u64cmp,
+                          &heap);
+    assert(err == 0);
+    assert(heap);
+    assert(ds_sheap_len(heap) == 0);
+    /* An 8-byte key plus slot index */
+    assert(heap->entries.esize == 16);
+    ds_sheap_free(heap);
+    return 0;
+}
+
+static int add(void) {
+    uint64_t keys[] = {5, 3, 9, 1, 7};
+    uint64_t mins[] = {5, 3, 3, 1, 1};
+    struct split_heap *heap;
+    struct job job;
+    uint64_t key;
+    int err;
+
+    err = ds_sheap_create(sizeof(uint64_t), sizeof(struct job), u64cmp,
+                          &heap);
+    assert(err == 0);
+
+    err = ds_sheap_get_min(heap, &key, &job);
+    assert(err != 0);
+
+    for (int i = 0; i < ARRAY_LEN(keys); i++) {
+        make_job(&job, keys[i]);
+        err = ds_sheap_add(heap, &keys[i], &job);
+        assert(err == 0);
+        assert(ds_sheap_len(heap) == i + 1);
+
+        err = ds_sheap_get_min(heap, &key, &job);
+        assert(err == 0);
+        assert(key == mins[i]);
+        check_job(&job, mins[i]);
+    }
+
+    ds_sheap_free(heap);
+    return 0;
+}
+
+static int pop(void) {
+    struct split_heap *heap;
+    const int n = 2000;
+    uint64_t prev, key;
+    struct job job;
+    int err;
+
+    err = ds_sheap_create(sizeof(uint64_t), sizeof(struct job), u64cmp,
+                          &heap);
+    assert(err == 0);
+
+    srand(1);
+    for (int i = 0; i < n; i++) {
+        key = rand() % 1000;
+        make_job(&job, key);
+        err = ds_sheap_add(heap, &key, &job);
+        assert(err == 0);
+    }
+
+    prev = 0;
+    for (int i = 0; i < n; i++) {
+        err = ds_sheap_pop_min(heap, &key, &job);
+        assert(err == 0);
+        assert(key >= prev);
+        check_job(&job, key);
+        prev = key;
+    }
+    assert(ds_sheap_len(heap) == 0);
+
+    err = ds_sheap_pop_min(heap, &key, &job);
+    assert(err != 0);
+
+    ds_sheap_free(heap);
+    return 0;
+}
+
+static int reuse_slots(void) {
+    struct split_heap *heap;
+    uint64_t key, popped;
+    struct job job;
+    int err;
+
+    err = ds_sheap_create(sizeof(uint64_t), sizeof(struct job), u64cmp,
+                          &heap);
+    assert(err == 0);
+
+    for (key = 0; key < 10; key++) {
+        make_job(&job, key);
+        err = ds_sheap_add(heap, &key, &job);
+        assert(err == 0);
+    }
+
+    /* Steady state churn should not grow the payload slots */
+    for (key = 10; key < 1000; key++) {
+        err = ds_sheap_pop_min(heap, &popped, NULL);
+        assert(err == 0);
+        assert(popped == key - 10);
+
+        make_job(&job, key);
+        err = ds_sheap_add(heap, &key, &job);
+        assert(err == 0);
+        assert(ds_da_len(&heap->payloads) == 10);
+    }
+
+    for (key = 990; key < 1000; key++) {
+        err = ds_sheap_pop_min(heap, &popped, &job);
+        assert(err == 0);
+        assert(popped == key);
+        check_job(&job, key);
+    }
+
+    ds_sheap_free(heap);
+    return 0;
+}
+
+int main(void) {
+    tap_easy_register(create, "Checks creation");
+    tap_easy_register(add, "Checks adding keys and payloads");
+    tap_easy_register(pop, "Checks popping min");
+    tap_easy_register(reuse_slots, "Checks payload slots are reused");
+    tap_easy_runall_and_cleanup();
+}